@@ -0,0 +1,1296 @@
+// Microbenchmarks for the mse::TAsyncShared* types and the mutexes they're built on.
+// Build with something like:
+//   g++ -std=c++17 -O2 -pthread bench.cpp -o bench
+// (Build with -std=c++20 to include the "coroutine_waiters" and "cancellation" benchmarks.)
+// (Add -DMSE_ASYNCSHARED_LOCK_METRICS to have the "lock_metrics" benchmark report per-object contention metrics.)
+// (Add -DMSE_ASYNCSHAREDPOINTER_DISABLED to measure the "release_mode_parity" benchmark in release mode.)
+#include "../mseasyncshared.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <random>
+
+class CReadMostlyObj {
+public:
+	int value() const { return m_value; }
+	void set_value(int value) { m_value = value; }
+private:
+	int m_value = 0;
+};
+class CShardedReadMostlyObj : public CReadMostlyObj {};
+namespace mse {
+	template<> struct async_shared_timed_mutex_type_for<CShardedReadMostlyObj> { typedef sharded_recursive_shared_timed_mutex<> type; };
+}
+
+class CPriorityObj : public CReadMostlyObj {};
+namespace mse {
+	template<> struct async_shared_timed_mutex_type_for<CPriorityObj> { typedef priority_recursive_shared_timed_mutex type; };
+}
+
+namespace {
+	const size_t sc_max_num_threads = 64;
+
+	/* Runs func(thread_index) on num_threads threads (all released at the same time) and returns the elapsed
+	wall clock time in seconds. */
+	template<class _TFunc>
+	double run_on_threads(size_t num_threads, _TFunc func) {
+		std::atomic<bool> go{ false };
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < num_threads; i += 1) {
+			threads.emplace_back([&go, &func, i]() {
+				while (!go.load(std::memory_order_acquire)) { std::this_thread::yield(); }
+				func(i);
+			});
+		}
+		auto t1 = std::chrono::steady_clock::now();
+		go.store(true, std::memory_order_release);
+		for (auto& thread_ref : threads) {
+			thread_ref.join();
+		}
+		auto t2 = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
+	}
+
+	std::vector<size_t> thread_counts(size_t max_num_threads = sc_max_num_threads) {
+		std::vector<size_t> retval;
+		for (size_t n = 1; n <= max_num_threads; n *= 2) {
+			retval.push_back(n);
+		}
+		return retval;
+	}
+
+	void print_row(const std::string& label, size_t num_threads, double num_ops, double seconds) {
+		std::cout << "  " << std::left << std::setw(44) << label << std::right << std::setw(4) << num_threads << " threads: "
+			<< std::setw(10) << std::fixed << std::setprecision(2) << (num_ops / seconds / 1.0e6) << " Mops/s" << std::endl;
+	}
+
+	template<class _TMutex>
+	void readlock_bookkeeping_row(const std::string& label, size_t num_threads) {
+		const size_t num_iterations = 200000;
+		_TMutex mutex1;
+		auto seconds = run_on_threads(num_threads, [&mutex1](size_t) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				/* an outer read lock and a recursive one */
+				mutex1.lock_shared();
+				mutex1.lock_shared();
+				mutex1.unlock_shared();
+				mutex1.unlock_shared();
+			}
+		});
+		print_row(label, num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_readlock_bookkeeping() {
+		std::cout << "readlock_bookkeeping: (recursive) read lock acquisitions" << std::endl;
+		for (auto num_threads : thread_counts(16)) {
+			readlock_bookkeeping_row<mse::recursive_shared_timed_mutex>("recursive_shared_timed_mutex", num_threads);
+			readlock_bookkeeping_row<mse::thread_local_recursive_shared_timed_mutex>("thread_local_recursive_shared_timed_mutex", num_threads);
+#ifdef __linux__
+			readlock_bookkeeping_row<mse::futex_recursive_shared_timed_mutex>("futex_recursive_shared_timed_mutex", num_threads);
+#endif // __linux__
+		}
+	}
+
+	template<class _Ty>
+	void read_mostly_row(const std::string& label, size_t num_threads) {
+		const size_t num_iterations = 100000;
+		auto access_requester = mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<_Ty>();
+		std::atomic<long long> total{ 0 };
+		auto seconds = run_on_threads(num_threads, [&access_requester, &total](size_t thread_index) {
+			long long sum = 0;
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				if ((0 == thread_index) && (0 == i % 1000)) {
+					/* the occasional write */
+					access_requester.writelock_ptr()->set_value(int(i));
+				}
+				sum += access_requester.readlock_ptr()->value();
+			}
+			total += sum;
+		});
+		print_row(label, num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_read_mostly() {
+		std::cout << "read_mostly: readlock_ptr() on one shared object, with a write every 1000 reads" << std::endl;
+		for (auto num_threads : thread_counts()) {
+			read_mostly_row<CReadMostlyObj>("async_shared_timed_mutex_type (default)", num_threads);
+			read_mostly_row<CShardedReadMostlyObj>("sharded_recursive_shared_timed_mutex<>", num_threads);
+		}
+	}
+
+	template<class _Ty>
+	void borrowed_row(bool borrowed, size_t num_threads) {
+		const size_t num_iterations = 100000;
+		auto access_requester = mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<_Ty>();
+		std::atomic<long long> total{ 0 };
+		auto seconds = run_on_threads(num_threads, [&access_requester, &total, borrowed](size_t) {
+			/* each thread uses its own copy of the access requester */
+			auto l_access_requester = access_requester;
+			long long sum = 0;
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				if (borrowed) {
+					sum += l_access_requester.borrowed_readlock_ptr()->value();
+				}
+				else {
+					sum += l_access_requester.readlock_ptr()->value();
+				}
+			}
+			total += sum;
+		});
+		print_row(borrowed ? "borrowed_readlock_ptr()" : "readlock_ptr()", num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_borrowed() {
+		std::cout << "borrowed: read locks (on a sharded_recursive_shared_timed_mutex) with and without the reference count update" << std::endl;
+		for (auto num_threads : thread_counts()) {
+			borrowed_row<CShardedReadMostlyObj>(false, num_threads);
+			borrowed_row<CShardedReadMostlyObj>(true, num_threads);
+		}
+	}
+
+	template<class _TLockPolicy>
+	void lock_policy_row(const std::string& label) {
+		const size_t num_iterations = 2000000;
+		auto access_requester = mse::make_asyncsharedaccess<CReadMostlyObj, _TLockPolicy>();
+		auto seconds = run_on_threads(1, [&access_requester](size_t) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				auto writelock_ptr = access_requester.writelock_ptr();
+				writelock_ptr->set_value(writelock_ptr->value() + 1);
+			}
+		});
+		print_row(label + ", writelock_ptr()", 1, double(num_iterations), seconds);
+		seconds = run_on_threads(1, [&access_requester](size_t) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				auto writelock_ptr = access_requester.borrowed_writelock_ptr();
+				writelock_ptr->set_value(writelock_ptr->value() + 1);
+			}
+		});
+		/* (with no_locking the whole loop typically compiles to a single addition) */
+		print_row(label + ", borrowed_writelock_ptr()", 1, double(num_iterations), seconds);
+	}
+
+	void bench_lock_policy() {
+		std::cout << "lock_policy: (uncontended) write locks with each of the TAsyncSharedAccessRequester<> lock policies" << std::endl;
+		lock_policy_row<mse::lock_policy::exclusive_reads>("exclusive_reads");
+		lock_policy_row<mse::lock_policy::shared_reads>("shared_reads");
+		lock_policy_row<mse::lock_policy::no_locking>("no_locking");
+	}
+
+	void short_critical_section_row(bool adaptive, size_t num_threads) {
+		const size_t num_iterations = 50000;
+		mse::recursive_shared_timed_mutex mutex1;
+		mutex1.set_adaptive_spinning(adaptive);
+		volatile long long shared_value = 0;
+		auto seconds = run_on_threads(num_threads, [&mutex1, &shared_value](size_t thread_index) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				if (0 == (i + thread_index) % 4) {
+					std::lock_guard<mse::recursive_shared_timed_mutex> lock1(mutex1);
+					shared_value = shared_value + 1;
+				}
+				else {
+					std::shared_lock<mse::recursive_shared_timed_mutex> lock1(mutex1);
+					long long value = shared_value;
+					(void)value;
+				}
+			}
+		});
+		print_row(adaptive ? "recursive_shared_timed_mutex (adaptive)" : "recursive_shared_timed_mutex", num_threads, double(num_threads * num_iterations), seconds);
+		if (adaptive) {
+			const auto stats = mutex1.adaptive_spin_stats();
+			std::cout << "      spin acquisitions: " << stats.m_num_spin_acquisitions << ", park acquisitions: " << stats.m_num_park_acquisitions
+				<< ", spin budget: " << stats.m_current_spin_budget.count() << " ns" << std::endl;
+		}
+	}
+
+	void bench_short_critical_sections() {
+		std::cout << "short_critical_sections: 1 write lock per 3 read locks, (almost) empty critical sections" << std::endl;
+		for (auto num_threads : thread_counts(16)) {
+			short_critical_section_row(false, num_threads);
+			short_critical_section_row(true, num_threads);
+		}
+	}
+
+	/* Spends the given amount of time (yielding the cpu). Used rather than sleep_for() to get critical sections (and the
+	gaps between them) of about the intended length, regardless of the timer granularity. */
+	void busy_wait_for(std::chrono::microseconds duration) {
+		const auto end_time = std::chrono::steady_clock::now() + duration;
+		while (std::chrono::steady_clock::now() < end_time) {
+			std::this_thread::yield();
+		}
+	}
+
+	void spin_recovery_phase(mse::recursive_shared_timed_mutex& mutex1, std::chrono::microseconds hold_time, std::chrono::milliseconds phase_duration) {
+		const auto stats1 = mutex1.adaptive_spin_stats();
+		std::atomic<bool> stop{ false };
+		std::thread writer_thread([&mutex1, &stop, hold_time]() {
+			while (!stop.load(std::memory_order_relaxed)) {
+				{
+					std::lock_guard<mse::recursive_shared_timed_mutex> lock1(mutex1);
+					busy_wait_for(hold_time);
+				}
+				busy_wait_for(hold_time);
+			}
+		});
+		const auto end_time = std::chrono::steady_clock::now() + phase_duration;
+		while (std::chrono::steady_clock::now() < end_time) {
+			{
+				std::shared_lock<mse::recursive_shared_timed_mutex> lock1(mutex1);
+			}
+			busy_wait_for(hold_time / 3);
+		}
+		stop.store(true, std::memory_order_relaxed);
+		writer_thread.join();
+		const auto stats2 = mutex1.adaptive_spin_stats();
+		std::cout << "  " << std::setw(5) << hold_time.count() << " us critical sections for " << std::setw(3) << phase_duration.count() << " ms: "
+			<< "spin acquisitions: " << std::setw(5) << (stats2.m_num_spin_acquisitions - stats1.m_num_spin_acquisitions)
+			<< ", park acquisitions: " << std::setw(5) << (stats2.m_num_park_acquisitions - stats1.m_num_park_acquisitions)
+			<< ", spin budget: " << std::setw(5) << stats2.m_current_spin_budget.count() << " ns" << std::endl;
+	}
+
+	void bench_spin_recovery() {
+		std::cout << "spin_recovery: the adaptive spin budget over phases of short, long, then short again critical sections" << std::endl;
+		mse::recursive_shared_timed_mutex mutex1;
+		mutex1.set_adaptive_spinning(true);
+		spin_recovery_phase(mutex1, std::chrono::microseconds(10), std::chrono::milliseconds(200));
+		spin_recovery_phase(mutex1, std::chrono::microseconds(2000), std::chrono::milliseconds(300));
+		/* (The budget should recover within the first few probes.) */
+		spin_recovery_phase(mutex1, std::chrono::microseconds(10), std::chrono::milliseconds(50));
+		spin_recovery_phase(mutex1, std::chrono::microseconds(10), std::chrono::milliseconds(200));
+	}
+
+	template<class _TMutex>
+	void write_lock_row(const std::string& label, size_t num_threads) {
+		const size_t num_iterations = 100000;
+		_TMutex mutex1;
+		volatile long long shared_value = 0;
+		auto seconds = run_on_threads(num_threads, [&mutex1, &shared_value](size_t) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				std::lock_guard<_TMutex> lock1(mutex1);
+				shared_value = shared_value + 1;
+			}
+		});
+		print_row(label + " (" + std::to_string(sizeof(_TMutex)) + " bytes)", num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_write_lock() {
+		std::cout << "write_lock: write lock/unlock pairs, with the mutex's size" << std::endl;
+		for (auto num_threads : thread_counts(16)) {
+			write_lock_row<mse::recursive_shared_timed_mutex>("recursive_shared_timed_mutex", num_threads);
+#ifdef __linux__
+			write_lock_row<mse::futex_recursive_shared_timed_mutex>("futex_recursive_shared_timed_mutex", num_threads);
+#endif // __linux__
+		}
+	}
+
+	/* A stress test for the timed lock functions. Two threads repeatedly make timed (100ms) lock requests while the
+	other threads make ordinary (untimed) ones. A timed wait shouldn't prevent other threads from releasing their locks
+	(or otherwise stall them). */
+	void timed_waits_row(size_t num_untimed_threads) {
+		const auto duration = std::chrono::milliseconds(500);
+		const auto timeout = std::chrono::milliseconds(100);
+		mse::recursive_shared_timed_mutex mutex1;
+		volatile long long shared_value = 0;
+		std::atomic<long long> num_untimed_ops{ 0 };
+		std::atomic<long long> num_timed_acquisitions{ 0 };
+		std::atomic<long long> num_timeouts{ 0 };
+		const auto end_time = std::chrono::steady_clock::now() + duration;
+		auto seconds = run_on_threads(num_untimed_threads + 2, [&](size_t thread_index) {
+			long long count = 0;
+			while (std::chrono::steady_clock::now() < end_time) {
+				if (0 == thread_index) {
+					if (mutex1.try_lock_for(timeout)) {
+						shared_value = shared_value + 1;
+						mutex1.unlock();
+						num_timed_acquisitions += 1;
+					}
+					else {
+						num_timeouts += 1;
+					}
+				}
+				else if (1 == thread_index) {
+					if (mutex1.try_lock_shared_for(timeout)) {
+						long long value = shared_value;
+						(void)value;
+						mutex1.unlock_shared();
+						num_timed_acquisitions += 1;
+					}
+					else {
+						num_timeouts += 1;
+					}
+				}
+				else if (0 == count % 2) {
+					std::lock_guard<mse::recursive_shared_timed_mutex> lock1(mutex1);
+					shared_value = shared_value + 1;
+					count += 1;
+				}
+				else {
+					std::shared_lock<mse::recursive_shared_timed_mutex> lock1(mutex1);
+					long long value = shared_value;
+					(void)value;
+					count += 1;
+				}
+			}
+			num_untimed_ops += count;
+		});
+		print_row("untimed lock/unlock pairs", num_untimed_threads, double(num_untimed_ops.load()), seconds);
+		std::cout << "      timed acquisitions: " << num_timed_acquisitions.load() << ", timeouts: " << num_timeouts.load() << std::endl;
+	}
+
+	void bench_timed_waits() {
+		std::cout << "timed_waits: mixed timed (100ms) and untimed lockers of a recursive_shared_timed_mutex (untimed threads shown)" << std::endl;
+		for (auto num_threads : thread_counts(8)) {
+			timed_waits_row(num_threads);
+		}
+	}
+
+	/* returns the given percentile of the (sorted) samples */
+	template<class _Ty>
+	_Ty percentile(const std::vector<_Ty>& sorted_samples, double fraction) {
+		if (sorted_samples.empty()) {
+			return _Ty();
+		}
+		auto index = size_t(fraction * double(sorted_samples.size() - 1) + 0.5);
+		return sorted_samples.at(index);
+	}
+
+	template<class _TFairnessPolicy>
+	void writer_latency_row(const std::string& label) {
+		const size_t num_readers = 8;
+		const size_t num_writes = 100;
+		const auto max_duration = std::chrono::seconds(3);
+		mse::basic_recursive_shared_timed_mutex<_TFairnessPolicy> mutex1;
+		std::atomic<bool> stop_readers{ false };
+		std::atomic<long long> num_reads{ 0 };
+		std::vector<double> write_wait_us;
+		std::atomic<size_t> num_writes_done{ 0 };
+
+		std::vector<std::thread> reader_threads;
+		for (size_t i = 0; i < num_readers; i += 1) {
+			reader_threads.emplace_back([&]() {
+				long long count = 0;
+				while (!stop_readers.load(std::memory_order_relaxed)) {
+					std::shared_lock<decltype(mutex1)> lock1(mutex1);
+					/* readers hold the lock for a bit, so that their critical sections overlap */
+					auto t1 = std::chrono::steady_clock::now();
+					while (std::chrono::steady_clock::now() - t1 < std::chrono::microseconds(20)) {}
+					count += 1;
+				}
+				num_reads += count;
+			});
+		}
+		auto start_time = std::chrono::steady_clock::now();
+		std::thread writer_thread([&]() {
+			for (size_t i = 0; i < num_writes; i += 1) {
+				if (std::chrono::steady_clock::now() - start_time > max_duration) {
+					break;
+				}
+				auto t1 = std::chrono::steady_clock::now();
+				{
+					std::lock_guard<decltype(mutex1)> lock1(mutex1);
+					auto t2 = std::chrono::steady_clock::now();
+					write_wait_us.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(t2 - t1).count());
+				}
+				num_writes_done += 1;
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		});
+		/* The readers are stopped when the writer is done, or the time is up, whichever comes first. (With a reader
+		preferring lock, the writer might otherwise never get in.) */
+		while ((num_writes_done.load() < num_writes) && (std::chrono::steady_clock::now() - start_time <= max_duration)) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		stop_readers = true;
+		writer_thread.join();
+		for (auto& thread_ref : reader_threads) {
+			thread_ref.join();
+		}
+		auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start_time).count();
+
+		std::sort(write_wait_us.begin(), write_wait_us.end());
+		std::cout << "  " << std::left << std::setw(20) << label << std::right << std::fixed << std::setprecision(1)
+			<< " writes: " << std::setw(4) << write_wait_us.size()
+			<< ", writer wait p50: " << std::setw(9) << percentile(write_wait_us, 0.5) << " us"
+			<< ", p99: " << std::setw(9) << percentile(write_wait_us, 0.99) << " us"
+			<< ", max: " << std::setw(9) << (write_wait_us.empty() ? 0.0 : write_wait_us.back()) << " us"
+			<< ", reads/s: " << std::setw(9) << std::setprecision(0) << (double(num_reads.load()) / seconds) << std::endl;
+	}
+
+	void bench_writer_latency() {
+		std::cout << "writer_latency: time for a writer to acquire the lock while 8 threads continuously hold read locks" << std::endl;
+		writer_latency_row<mse::rw_fairness::platform_default>("platform_default");
+		writer_latency_row<mse::rw_fairness::reader_preferring>("reader_preferring");
+		writer_latency_row<mse::rw_fairness::writer_preferring>("writer_preferring");
+		writer_latency_row<mse::rw_fairness::phase_fair>("phase_fair");
+	}
+
+	/* Latency sensitive readers contending with (normal priority) bulk writers that hold the lock for a while. */
+	void priority_row(mse::priority reader_priority, const std::string& label) {
+		const size_t num_writers = 4;
+		const size_t num_readers = 2;
+		const auto duration = std::chrono::milliseconds(1000);
+		auto access_requester = mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<CPriorityObj>();
+		std::atomic<bool> stop{ false };
+		std::mutex samples_mutex;
+		std::vector<double> read_wait_us;
+		std::vector<double> write_wait_us;
+
+		auto elapsed_us = [](std::chrono::steady_clock::time_point t1) {
+			return std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(std::chrono::steady_clock::now() - t1).count();
+		};
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < num_writers; i += 1) {
+			threads.emplace_back([&]() {
+				std::vector<double> samples;
+				while (!stop.load(std::memory_order_relaxed)) {
+					auto t1 = std::chrono::steady_clock::now();
+					auto writelock_ptr = access_requester.writelock_ptr(mse::priority::normal);
+					samples.push_back(elapsed_us(t1));
+					/* a "bulk" operation */
+					std::this_thread::sleep_for(std::chrono::microseconds(200));
+					writelock_ptr->set_value(writelock_ptr->value() + 1);
+				}
+				std::lock_guard<std::mutex> lock1(samples_mutex);
+				write_wait_us.insert(write_wait_us.end(), samples.begin(), samples.end());
+			});
+		}
+		for (size_t i = 0; i < num_readers; i += 1) {
+			threads.emplace_back([&]() {
+				std::vector<double> samples;
+				while (!stop.load(std::memory_order_relaxed)) {
+					auto t1 = std::chrono::steady_clock::now();
+					{
+						auto readlock_ptr = access_requester.readlock_ptr(reader_priority);
+						samples.push_back(elapsed_us(t1));
+						(void)readlock_ptr->value();
+					}
+					std::this_thread::sleep_for(std::chrono::microseconds(500));
+				}
+				std::lock_guard<std::mutex> lock1(samples_mutex);
+				read_wait_us.insert(read_wait_us.end(), samples.begin(), samples.end());
+			});
+		}
+		std::this_thread::sleep_for(duration);
+		stop = true;
+		for (auto& thread_ref : threads) {
+			thread_ref.join();
+		}
+
+		std::sort(read_wait_us.begin(), read_wait_us.end());
+		std::sort(write_wait_us.begin(), write_wait_us.end());
+		auto print_waits = [](const std::string& row_label, const std::vector<double>& sorted_samples) {
+			std::cout << "  " << std::left << std::setw(36) << row_label << std::right << std::fixed << std::setprecision(1)
+				<< " n: " << std::setw(6) << sorted_samples.size()
+				<< ", wait p50: " << std::setw(9) << percentile(sorted_samples, 0.5) << " us"
+				<< ", p99: " << std::setw(9) << percentile(sorted_samples, 0.99) << " us"
+				<< ", max: " << std::setw(9) << (sorted_samples.empty() ? 0.0 : sorted_samples.back()) << " us" << std::endl;
+		};
+		print_waits(label + " readers", read_wait_us);
+		print_waits("  (bulk writers)", write_wait_us);
+	}
+
+	void bench_priority() {
+		std::cout << "priority: lock wait times of normal vs. high priority readers contending with normal priority bulk writers" << std::endl;
+		priority_row(mse::priority::normal, "normal priority");
+		priority_row(mse::priority::high, "high priority");
+	}
+
+#ifdef MSE_ASYNCSHARED_HAS_STOP_TOKEN
+	/* The time it takes a writer blocked in writelock_ptr(stop_token) to give up after a stop is requested. */
+	template<class _TAccessRequester>
+	void cancellation_row(_TAccessRequester access_requester, const std::string& label) {
+		const size_t num_trials = 200;
+		std::vector<double> cancel_latency_us;
+		size_t num_obtained = 0;
+		for (size_t i = 0; i < num_trials; i += 1) {
+			auto writelock_ptr = access_requester.writelock_ptr();
+			std::stop_source stop_source;
+			std::chrono::steady_clock::time_point t2;
+			bool obtained = false;
+			std::thread waiter([&]() {
+				auto waiter_writelock_ptr = access_requester.writelock_ptr(stop_source.get_token());
+				t2 = std::chrono::steady_clock::now();
+				obtained = bool(waiter_writelock_ptr);
+			});
+			std::this_thread::sleep_for(std::chrono::microseconds(500 + 10 * i));
+			auto t1 = std::chrono::steady_clock::now();
+			stop_source.request_stop();
+			waiter.join();
+			num_obtained += obtained ? 1 : 0;
+			cancel_latency_us.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(t2 - t1).count());
+		}
+		std::sort(cancel_latency_us.begin(), cancel_latency_us.end());
+		std::cout << "  " << std::left << std::setw(36) << label << std::right << std::fixed << std::setprecision(1)
+			<< " cancelled: " << std::setw(4) << (num_trials - num_obtained) << "/" << num_trials
+			<< ", latency p50: " << std::setw(7) << percentile(cancel_latency_us, 0.5) << " us"
+			<< ", p99: " << std::setw(7) << percentile(cancel_latency_us, 0.99) << " us"
+			<< ", max: " << std::setw(7) << cancel_latency_us.back() << " us" << std::endl;
+	}
+
+	void bench_cancellation() {
+		std::cout << "cancellation: time from request_stop() until a blocked writelock_ptr(stop_token) call returns (empty)" << std::endl;
+		cancellation_row(mse::make_asyncsharedreadwrite<CReadMostlyObj>(), "TAsyncSharedReadWriteAccessRequester");
+		cancellation_row(mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<CReadMostlyObj>(), "...NoUnprotectedMutablesReadWrite...");
+		cancellation_row(mse::make_asyncsharedstripedreadwrite<CReadMostlyObj>(), "TAsyncSharedStripedReadWrite...");
+
+		/* and the (uncontended) overhead of passing a stop_token */
+		const size_t num_iterations = 1000000;
+		auto access_requester = mse::make_asyncsharedreadwrite<CReadMostlyObj>();
+		auto seconds = run_on_threads(1, [&](size_t) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				auto writelock_ptr = access_requester.writelock_ptr();
+				writelock_ptr->set_value(writelock_ptr->value() + 1);
+			}
+		});
+		print_row("uncontended writelock_ptr()", 1, double(num_iterations), seconds);
+		std::stop_source stop_source;
+		seconds = run_on_threads(1, [&](size_t) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				auto writelock_ptr = access_requester.writelock_ptr(stop_source.get_token());
+				writelock_ptr->set_value(writelock_ptr->value() + 1);
+			}
+		});
+		print_row("uncontended writelock_ptr(stop_token)", 1, double(num_iterations), seconds);
+	}
+#endif // MSE_ASYNCSHARED_HAS_STOP_TOKEN
+
+	/* Increments the value if it's even. The "reread" version drops its read lock, obtains a write lock, and then
+	has to re-check the value. The "upgrade" version upgrades its (upgradeable) read lock instead. */
+	void read_check_write_row(bool use_upgrade, size_t num_threads) {
+		const size_t num_iterations = 20000;
+		auto access_requester = mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<CReadMostlyObj>();
+		std::atomic<long long> num_rechecks_failed{ 0 };
+		auto seconds = run_on_threads(num_threads, [&](size_t) {
+			long long rechecks_failed = 0;
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				if (use_upgrade) {
+					auto upgradeable_ptr = access_requester.upgradeable_readlock_ptr();
+					if (0 == upgradeable_ptr->value() % 2) {
+						auto writelock_ptr = upgradeable_ptr.upgrade();
+						writelock_ptr->set_value(writelock_ptr->value() + 1);
+					}
+				}
+				else {
+					bool is_even = false;
+					{
+						auto readlock_ptr = access_requester.readlock_ptr();
+						is_even = (0 == readlock_ptr->value() % 2);
+					}
+					if (is_even) {
+						auto writelock_ptr = access_requester.writelock_ptr();
+						if (0 == writelock_ptr->value() % 2) {
+							writelock_ptr->set_value(writelock_ptr->value() + 1);
+						}
+						else {
+							rechecks_failed += 1;
+						}
+					}
+				}
+				if (0 == i % 2) {
+					/* an unconditional write, so that there's something to do next time */
+					auto writelock_ptr = access_requester.writelock_ptr();
+					writelock_ptr->set_value(writelock_ptr->value() + 1);
+				}
+			}
+			num_rechecks_failed += rechecks_failed;
+		});
+		print_row(use_upgrade ? "upgradeable_readlock_ptr() + upgrade()" : "readlock_ptr(), writelock_ptr(), recheck", num_threads, double(num_threads * num_iterations), seconds);
+		if (!use_upgrade) {
+			std::cout << "      rechecks that failed (wasted reads): " << num_rechecks_failed.load() << std::endl;
+		}
+	}
+
+	void bench_read_check_write() {
+		std::cout << "read_check_write: conditionally increment a shared value" << std::endl;
+		for (auto num_threads : thread_counts(16)) {
+			read_check_write_row(false, num_threads);
+			read_check_write_row(true, num_threads);
+		}
+	}
+
+	struct CPoint {
+		double m_x = 0.0;
+		double m_y = 0.0;
+		double m_z = 0.0;
+	};
+
+	/* One thread writes continuously, the others read. Only the readers' throughput is reported. */
+	template<class _TRead, class _TWrite>
+	void one_writer_row(const std::string& label, size_t num_readers, _TRead read, _TWrite write) {
+		const size_t num_iterations = 200000;
+		std::atomic<bool> readers_done{ false };
+		std::atomic<size_t> num_readers_done{ 0 };
+		std::atomic<long long> num_torn_reads{ 0 };
+		auto seconds = run_on_threads(num_readers + 1, [&](size_t thread_index) {
+			if (0 == thread_index) {
+				double value = 0.0;
+				while (!readers_done.load(std::memory_order_relaxed)) {
+					value += 1.0;
+					write(value);
+				}
+				return;
+			}
+			long long torn_reads = 0;
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				const CPoint point = read();
+				if ((point.m_x != point.m_y) || (point.m_y != point.m_z)) {
+					torn_reads += 1;
+				}
+			}
+			num_torn_reads += torn_reads;
+			if (num_readers == (num_readers_done += 1)) {
+				readers_done = true;
+			}
+		});
+		print_row(label, num_readers, double(num_readers * num_iterations), seconds);
+		if (0 != num_torn_reads.load()) {
+			std::cout << "      torn reads: " << num_torn_reads.load() << std::endl;
+		}
+	}
+
+	void bench_seqlock() {
+		std::cout << "seqlock: reads of a small (24 byte) shared object while one writer is active (reader threads shown)" << std::endl;
+		for (auto num_readers : thread_counts(16)) {
+			auto seqlock_access_requester = mse::make_asyncsharedseqlock<CPoint>();
+			one_writer_row("TAsyncSharedSeqLockAccessRequester", num_readers
+				, [&]() { return seqlock_access_requester.load(); }
+				, [&](double value) { seqlock_access_requester.store(CPoint{ value, value, value }); });
+			auto access_requester = mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<CPoint>();
+			one_writer_row("...NoUnprotectedMutablesReadWrite...", num_readers
+				, [&]() { return CPoint(*(access_requester.readlock_ptr())); }
+				, [&](double value) { *(access_requester.writelock_ptr()) = CPoint{ value, value, value }; });
+		}
+	}
+
+	class CAccount {
+	public:
+		void add_to_balance(double amount) { m_balance += amount; }
+		double balance() const { return m_balance; }
+	private:
+		double m_balance = 1000.0;
+	};
+
+	/* Random transfers between accounts. (Locking the source and then the destination, in that order, could deadlock,
+	so the "sequential" version locks the accounts in (index) order.) */
+	void transfer_row(bool use_lock_all, size_t num_accounts, size_t num_threads) {
+		const size_t num_iterations = 20000;
+		std::vector<mse::TAsyncSharedReadWriteAccessRequester<CAccount>> accounts;
+		for (size_t i = 0; i < num_accounts; i += 1) {
+			accounts.push_back(mse::make_asyncsharedreadwrite<CAccount>());
+		}
+		auto seconds = run_on_threads(num_threads, [&](size_t thread_index) {
+			std::mt19937 rng(static_cast<unsigned>(thread_index));
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				const auto source_index = rng() % num_accounts;
+				auto destination_index = rng() % num_accounts;
+				if (source_index == destination_index) {
+					destination_index = (destination_index + 1) % num_accounts;
+				}
+				if (use_lock_all) {
+					auto [source_writelock_ptr, destination_writelock_ptr] = mse::lock_all(accounts[source_index], accounts[destination_index]);
+					if (source_writelock_ptr->balance() >= 1.0) {
+						source_writelock_ptr->add_to_balance(-1.0);
+						destination_writelock_ptr->add_to_balance(1.0);
+					}
+				}
+				else {
+					auto first_writelock_ptr = accounts[std::min(source_index, destination_index)].writelock_ptr();
+					auto second_writelock_ptr = accounts[std::max(source_index, destination_index)].writelock_ptr();
+					auto& source_writelock_ptr = (source_index < destination_index) ? first_writelock_ptr : second_writelock_ptr;
+					auto& destination_writelock_ptr = (source_index < destination_index) ? second_writelock_ptr : first_writelock_ptr;
+					if (source_writelock_ptr->balance() >= 1.0) {
+						source_writelock_ptr->add_to_balance(-1.0);
+						destination_writelock_ptr->add_to_balance(1.0);
+					}
+				}
+			}
+		});
+		print_row(std::string(use_lock_all ? "lock_all()" : "ordered writelock_ptr()s") + ", " + std::to_string(num_accounts) + " accounts"
+			, num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_transfer() {
+		std::cout << "transfer: atomic transfers between random pairs of accounts" << std::endl;
+		for (auto num_accounts : { size_t(4), size_t(64) }) {
+			for (auto num_threads : thread_counts(16)) {
+				transfer_row(false, num_accounts, num_threads);
+				transfer_row(true, num_accounts, num_threads);
+			}
+		}
+	}
+
+	/* Random transfers between accounts, with lock_all() on per-object mutexes vs. (optimistic) transact() on seqlock objects. */
+	void transact_row(bool use_transact, size_t num_accounts, size_t num_threads) {
+		const size_t num_iterations = 20000;
+		std::vector<mse::TAsyncSharedReadWriteAccessRequester<CAccount>> accounts;
+		std::vector<mse::TAsyncSharedSeqLockAccessRequester<CAccount>> seqlock_accounts;
+		for (size_t i = 0; i < num_accounts; i += 1) {
+			accounts.push_back(mse::make_asyncsharedreadwrite<CAccount>());
+			seqlock_accounts.push_back(mse::make_asyncsharedseqlock<CAccount>());
+		}
+		auto seconds = run_on_threads(num_threads, [&](size_t thread_index) {
+			std::mt19937 rng(static_cast<unsigned>(thread_index));
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				const auto source_index = rng() % num_accounts;
+				auto destination_index = rng() % num_accounts;
+				if (source_index == destination_index) {
+					destination_index = (destination_index + 1) % num_accounts;
+				}
+				if (use_transact) {
+					mse::transact([](CAccount& source_ref, CAccount& destination_ref) {
+						if (source_ref.balance() < 1.0) {
+							return false;
+						}
+						source_ref.add_to_balance(-1.0);
+						destination_ref.add_to_balance(1.0);
+						return true;
+					}, seqlock_accounts[source_index], seqlock_accounts[destination_index]);
+				}
+				else {
+					auto [source_writelock_ptr, destination_writelock_ptr] = mse::lock_all(accounts[source_index], accounts[destination_index]);
+					if (source_writelock_ptr->balance() >= 1.0) {
+						source_writelock_ptr->add_to_balance(-1.0);
+						destination_writelock_ptr->add_to_balance(1.0);
+					}
+				}
+			}
+		});
+		print_row(std::string(use_transact ? "transact()" : "lock_all()") + ", " + std::to_string(num_accounts) + " accounts"
+			, num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_transact() {
+		std::cout << "transact: random transfers between accounts, pessimistic (lock_all()) vs. optimistic (transact())" << std::endl;
+		for (auto num_accounts : { size_t(4), size_t(1000) }) {
+			for (auto num_threads : thread_counts(16)) {
+				transact_row(false, num_accounts, num_threads);
+				transact_row(true, num_accounts, num_threads);
+			}
+		}
+	}
+
+	/* A minimal (per-thread, per-size) free list allocator, standing in for an application's pool allocator. Memory
+	must be deallocated by the thread that allocated it. */
+	template<class _Ty>
+	class CFreeListAllocator {
+	public:
+		typedef _Ty value_type;
+		CFreeListAllocator() {}
+		template<class _Ty2> CFreeListAllocator(const CFreeListAllocator<_Ty2>&) {}
+		_Ty* allocate(size_t n) {
+			auto& free_list_ref = free_list();
+			if ((1 == n) && (!free_list_ref.empty())) {
+				auto retval = static_cast<_Ty*>(free_list_ref.back());
+				free_list_ref.pop_back();
+				return retval;
+			}
+			return std::allocator<_Ty>().allocate(n);
+		}
+		void deallocate(_Ty* p, size_t n) {
+			if (1 == n) {
+				free_list().push_back(p);
+			}
+			else {
+				std::allocator<_Ty>().deallocate(p, n);
+			}
+		}
+		template<class _Ty2> bool operator==(const CFreeListAllocator<_Ty2>&) const { return true; }
+		template<class _Ty2> bool operator!=(const CFreeListAllocator<_Ty2>&) const { return false; }
+	private:
+		class CFreeList : public std::vector<void*> {
+		public:
+			~CFreeList() {
+				for (auto p : *this) {
+					std::allocator<_Ty>().deallocate(static_cast<_Ty*>(p), 1);
+				}
+			}
+		};
+		static CFreeList& free_list() {
+			thread_local CFreeList tl_free_list;
+			return tl_free_list;
+		}
+	};
+
+	std::atomic<long long>& num_bytes_allocated() {
+		static std::atomic<long long> s_count{ 0 };
+		return s_count;
+	}
+	/* An allocator that keeps a (global) count of the bytes it currently has allocated. */
+	template<class _Ty>
+	class CCountingAllocator {
+	public:
+		typedef _Ty value_type;
+		CCountingAllocator() {}
+		template<class _Ty2> CCountingAllocator(const CCountingAllocator<_Ty2>&) {}
+		_Ty* allocate(size_t n) {
+			num_bytes_allocated() += n * sizeof(_Ty);
+			return std::allocator<_Ty>().allocate(n);
+		}
+		void deallocate(_Ty* p, size_t n) {
+			num_bytes_allocated() -= n * sizeof(_Ty);
+			std::allocator<_Ty>().deallocate(p, n);
+		}
+		template<class _Ty2> bool operator==(const CCountingAllocator<_Ty2>&) const { return true; }
+		template<class _Ty2> bool operator!=(const CCountingAllocator<_Ty2>&) const { return false; }
+	};
+
+	template<class _TAllocateFunc>
+	void memory_row(const std::string& label, _TAllocateFunc allocate_func) {
+		const size_t num_objects = 100000;
+		const size_t num_objects_to_report = 10000000;
+		typedef decltype(allocate_func()) pointer_type;
+		std::vector<pointer_type> pointers;
+		pointers.reserve(num_objects);
+		auto num_bytes_before = num_bytes_allocated().load();
+		for (size_t i = 0; i < num_objects; i += 1) {
+			pointers.push_back(allocate_func());
+		}
+		auto bytes_per_object = double(num_bytes_allocated().load() - num_bytes_before) / num_objects;
+		std::cout << "  " << std::left << std::setw(44) << label << std::right << std::setw(8) << std::fixed << std::setprecision(0)
+			<< bytes_per_object << " bytes/object, " << std::setw(8) << std::setprecision(1)
+			<< (bytes_per_object * num_objects_to_report / (1024.0 * 1024.0)) << " MB per " << num_objects_to_report << " objects" << std::endl;
+	}
+
+	void bench_immutable() {
+		std::cout << "immutable: memory used by small objects that are never modified after construction" << std::endl;
+		memory_row("allocate_asyncsharedreadonly<>()", []() {
+			return mse::allocate_asyncsharedreadonly<CReadMostlyObj>(CCountingAllocator<CReadMostlyObj>());
+		});
+		memory_row("allocate_asyncsharedv2immutable<>()", []() {
+			return mse::allocate_asyncsharedv2immutable<CReadMostlyObj>(CCountingAllocator<CReadMostlyObj>());
+		});
+	}
+
+	template<class _TAccessRequester, class _TMakeFunc>
+	void striped_transfer_row(const std::string& label, size_t num_accounts, size_t num_threads, _TMakeFunc make_func) {
+		const size_t num_iterations = 20000;
+		std::vector<_TAccessRequester> accounts;
+		for (size_t i = 0; i < num_accounts; i += 1) {
+			accounts.push_back(make_func());
+		}
+		auto seconds = run_on_threads(num_threads, [&](size_t thread_index) {
+			std::mt19937 rng(static_cast<unsigned>(thread_index));
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				const auto source_index = rng() % num_accounts;
+				auto destination_index = rng() % num_accounts;
+				if (source_index == destination_index) {
+					destination_index = (destination_index + 1) % num_accounts;
+				}
+				auto [source_writelock_ptr, destination_writelock_ptr] = mse::lock_all(accounts[source_index], accounts[destination_index]);
+				if (source_writelock_ptr->balance() >= 1.0) {
+					source_writelock_ptr->add_to_balance(-1.0);
+					destination_writelock_ptr->add_to_balance(1.0);
+				}
+			}
+		});
+		print_row(label + ", " + std::to_string(num_accounts) + " accounts", num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_striped() {
+		std::cout << "striped: per-object mutexes vs. a (256 stripe) striped lock table, with lock_all() transfers between accounts" << std::endl;
+		memory_row("allocate_asyncsharedreadwrite<>()", []() {
+			return mse::allocate_asyncsharedreadwrite<CAccount>(CCountingAllocator<CAccount>());
+		});
+		memory_row("allocate_asyncsharedstripedreadwrite<>()", []() {
+			return mse::allocate_asyncsharedstripedreadwrite<CAccount>(CCountingAllocator<CAccount>());
+		});
+		std::cout << "  (plus " << sizeof(mse::striped_lock_table<>) << " bytes for the lock table, shared by all the striped objects)" << std::endl;
+		const size_t num_accounts = 100000;
+		for (auto num_threads : thread_counts(16)) {
+			striped_transfer_row<mse::TAsyncSharedReadWriteAccessRequester<CAccount>>("per-object mutexes", num_accounts, num_threads, []() {
+				return mse::make_asyncsharedreadwrite<CAccount>();
+			});
+			striped_transfer_row<mse::TAsyncSharedStripedReadWriteAccessRequester<CAccount>>("striped", num_accounts, num_threads, []() {
+				return mse::make_asyncsharedstripedreadwrite<CAccount>();
+			});
+		}
+	}
+
+	template<class _TFunc>
+	void creation_row(const std::string& label, size_t num_threads, _TFunc create_and_destroy) {
+		const size_t num_iterations = 200000;
+		auto seconds = run_on_threads(num_threads, [&create_and_destroy](size_t) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				create_and_destroy(i);
+			}
+		});
+		print_row(label, num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_creation() {
+		std::cout << "creation: creation and destruction of (short-lived) shared objects" << std::endl;
+		/* A stand-in for the shared object, to show the cost of the separate control block allocation that the
+		factories used to incur. */
+		class CSameSizeAsSharedObj {
+		public:
+			alignas(mse::TAsyncSharedObj<CReadMostlyObj>) unsigned char m_bytes[sizeof(mse::TAsyncSharedObj<CReadMostlyObj>)];
+		};
+		for (auto num_threads : thread_counts(8)) {
+			creation_row("same size object, shared_ptr<>(new ...)", num_threads, [](size_t i) {
+				std::shared_ptr<CSameSizeAsSharedObj> shptr(new CSameSizeAsSharedObj);
+				shptr->m_bytes[0] = (unsigned char)i;
+			});
+			creation_row("same size object, make_shared<>()", num_threads, [](size_t i) {
+				auto shptr = std::make_shared<CSameSizeAsSharedObj>();
+				shptr->m_bytes[0] = (unsigned char)i;
+			});
+			creation_row("make_asyncsharedreadwrite<>()", num_threads, [](size_t) {
+				auto access_requester = mse::make_asyncsharedreadwrite<CReadMostlyObj>();
+			});
+			creation_row("allocate_asyncsharedreadwrite<>(pool)", num_threads, [](size_t) {
+				auto access_requester = mse::allocate_asyncsharedreadwrite<CReadMostlyObj>(CFreeListAllocator<CReadMostlyObj>());
+			});
+		}
+	}
+
+	template<class _TFunc>
+	void release_mode_parity_row(const std::string& label, size_t num_threads, _TFunc func) {
+		const size_t num_iterations = 200000;
+		std::atomic<long long> total{ 0 };
+		auto seconds = run_on_threads(num_threads, [&func, &total](size_t) {
+			long long sum = 0;
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				sum += func(i);
+			}
+			total += sum;
+		});
+		print_row(label, num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_release_mode_parity() {
+		std::cout << "release_mode_parity: lock pointers vs. hand-written std::unique_lock/std::shared_lock on the same mutex type" << std::endl;
+#ifdef MSE_ASYNCSHAREDPOINTER_DISABLED
+		std::cout << "  (release mode, pointer size: " << sizeof(mse::TAsyncSharedReadWritePointer<CReadMostlyObj>) << " bytes)" << std::endl;
+#else // MSE_ASYNCSHAREDPOINTER_DISABLED
+		std::cout << "  (checked mode, pointer size: " << sizeof(mse::TAsyncSharedReadWritePointer<CReadMostlyObj>)
+			<< " bytes, rebuild with -DMSE_ASYNCSHAREDPOINTER_DISABLED for the release mode numbers)" << std::endl;
+#endif // MSE_ASYNCSHAREDPOINTER_DISABLED
+		typedef mse::async_shared_timed_mutex_type_for<CReadMostlyObj>::type mutex_type;
+		struct CHandWritten {
+			mutable mutex_type m_mutex;
+			CReadMostlyObj m_obj;
+		} hand_written;
+		auto rw_access_requester = mse::make_asyncsharedreadwrite<CReadMostlyObj>();
+		auto nu_access_requester = mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<CReadMostlyObj>();
+		for (auto num_threads : thread_counts(4)) {
+			release_mode_parity_row("hand-written std::unique_lock<>", num_threads, [&hand_written](size_t i) {
+				std::unique_lock<mutex_type> lock1(hand_written.m_mutex);
+				hand_written.m_obj.set_value(int(i));
+				return hand_written.m_obj.value();
+			});
+			release_mode_parity_row("writelock_ptr()", num_threads, [&rw_access_requester](size_t i) {
+				auto writelock_ptr = rw_access_requester.writelock_ptr();
+				writelock_ptr->set_value(int(i));
+				return writelock_ptr->value();
+			});
+			release_mode_parity_row("hand-written std::shared_lock<>", num_threads, [&hand_written](size_t) {
+				std::shared_lock<mutex_type> lock1(hand_written.m_mutex);
+				return hand_written.m_obj.value();
+			});
+			release_mode_parity_row("readlock_ptr() (no unprotected mutables)", num_threads, [&nu_access_requester](size_t) {
+				return nu_access_requester.readlock_ptr()->value();
+			});
+		}
+	}
+
+	class CImage {
+	public:
+		CImage(size_t num_pixels = 256 * 256) : m_pixels(num_pixels, 0) {}
+		unsigned char pixel(size_t index) const { return m_pixels[index % m_pixels.size()]; }
+		void set_pixel(size_t index, unsigned char value) { m_pixels[index % m_pixels.size()] = value; }
+	private:
+		std::vector<unsigned char> m_pixels;
+	};
+
+	void snapshot_row(bool use_snapshot, size_t num_threads) {
+		const size_t num_iterations = 100000;
+		auto snapshot_access_requester = mse::make_asyncsharedsnapshot<CImage>();
+		auto nu_access_requester = mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<CImage>();
+		std::atomic<long long> total{ 0 };
+		auto seconds = run_on_threads(num_threads, [&](size_t thread_index) {
+			long long sum = 0;
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				if ((0 == thread_index) && (0 == i % 10000)) {
+					/* the occasional write */
+					if (use_snapshot) {
+						snapshot_access_requester.modify([i](CImage& image_ref) { image_ref.set_pixel(i, (unsigned char)i); });
+					}
+					else {
+						nu_access_requester.writelock_ptr()->set_pixel(i, (unsigned char)i);
+					}
+				}
+				if (use_snapshot) {
+					sum += snapshot_access_requester.snapshot_ptr()->pixel(i);
+				}
+				else {
+					sum += nu_access_requester.readlock_ptr()->pixel(i);
+				}
+			}
+			total += sum;
+		});
+		print_row(use_snapshot ? "snapshot_ptr()" : "readlock_ptr() (no unprotected mutables)", num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_snapshot() {
+		std::cout << "snapshot: reads of a (64KB) image, with a write every 10000 reads" << std::endl;
+		for (auto num_threads : thread_counts()) {
+			snapshot_row(false, num_threads);
+			snapshot_row(true, num_threads);
+		}
+	}
+
+	void bench_weak() {
+		std::cout << "weak: lookups (and reads) via a cache of weak access requesters vs. a cache of (strong) access requesters" << std::endl;
+		const size_t num_images = 64;
+		const size_t num_iterations = 100000;
+		std::vector<mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<CImage>> owners;
+		std::vector<mse::TAsyncSharedWeakObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<CImage>> weak_cache;
+		for (size_t i = 0; i < num_images; i += 1) {
+			owners.push_back(mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<CImage>());
+			weak_cache.emplace_back(owners.back());
+		}
+		for (auto num_threads : thread_counts(16)) {
+			auto seconds = run_on_threads(num_threads, [&owners](size_t) {
+				long long sum = 0;
+				for (size_t i = 0; i < num_iterations; i += 1) {
+					auto access_requester = owners[i % num_images];
+					sum += access_requester.readlock_ptr()->pixel(i);
+				}
+				(void)sum;
+			});
+			print_row("strong cache", num_threads, double(num_threads * num_iterations), seconds);
+			seconds = run_on_threads(num_threads, [&weak_cache](size_t) {
+				long long sum = 0;
+				for (size_t i = 0; i < num_iterations; i += 1) {
+					auto maybe_access_requester = weak_cache[i % num_images].try_strong_access_requester();
+					if (maybe_access_requester) {
+						sum += maybe_access_requester->readlock_ptr()->pixel(i);
+					}
+				}
+				(void)sum;
+			});
+			print_row("weak cache, try_strong_access_requester()", num_threads, double(num_threads * num_iterations), seconds);
+		}
+		/* Once the owners are gone, the cache no longer keeps the images alive, and its entries can be pruned in bulk. */
+		owners.erase(owners.begin() + num_images / 2, owners.end());
+		auto num_erased = mse::erase_expired(weak_cache);
+		std::cout << "  (after releasing half the owners, erase_expired() pruned " << num_erased << " of " << num_images
+			<< " cache entries, freeing " << (num_erased * 64) << " KB of images)" << std::endl;
+	}
+
+	void flat_combining_row(bool use_apply, size_t num_threads) {
+		const size_t num_iterations = 50000;
+		auto account = mse::make_asyncsharedreadwrite<CAccount>();
+		auto seconds = run_on_threads(num_threads, [&account, use_apply](size_t) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				if (use_apply) {
+					account.apply([](CAccount& account_ref) { account_ref.add_to_balance(1.0); });
+				}
+				else {
+					account.writelock_ptr()->add_to_balance(1.0);
+				}
+			}
+		});
+		print_row(use_apply ? "apply() (flat combining)" : "writelock_ptr()", num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_flat_combining() {
+		std::cout << "flat_combining: short mutations (add_to_balance()) of a single (heavily contended) account" << std::endl;
+		for (auto num_threads : thread_counts()) {
+			flat_combining_row(false, num_threads);
+			flat_combining_row(true, num_threads);
+		}
+	}
+
+	enum class actor_mode { writelock_ptr, apply, post };
+	void actor_row(actor_mode mode, size_t num_threads) {
+		const size_t num_iterations = 50000;
+		auto account = mse::make_asyncsharedreadwrite<CAccount>();
+		auto actor = mse::make_asyncsharedactor<CAccount>();
+		auto seconds = run_on_threads(num_threads, [&account, &actor, mode](size_t) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				if (actor_mode::post == mode) {
+					actor.post([](CAccount& account_ref) { account_ref.add_to_balance(1.0); });
+				}
+				else if (actor_mode::apply == mode) {
+					account.apply([](CAccount& account_ref) { account_ref.add_to_balance(1.0); });
+				}
+				else {
+					account.writelock_ptr()->add_to_balance(1.0);
+				}
+			}
+			if (actor_mode::post == mode) {
+				/* (Include the time for the owner thread to catch up.) */
+				actor.call([](CAccount&) {}).get();
+			}
+		});
+		const char* label = (actor_mode::post == mode) ? "actor post()" : (actor_mode::apply == mode) ? "apply() (flat combining)" : "writelock_ptr()";
+		print_row(label, num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_actor() {
+		std::cout << "actor: short mutations (add_to_balance()) of a single (heavily contended) account, posted to an owner thread vs. locked" << std::endl;
+		for (auto num_threads : thread_counts()) {
+			actor_row(actor_mode::writelock_ptr, num_threads);
+			actor_row(actor_mode::apply, num_threads);
+			actor_row(actor_mode::post, num_threads);
+		}
+	}
+
+	void atomic_row(bool use_atomic, size_t num_threads) {
+		const size_t num_iterations = 200000;
+		auto atomic_counter = mse::make_asyncsharedv2atomic<long long>(0);
+		auto locked_counter = mse::make_asyncsharedreadwrite<CReadMostlyObj>();
+		auto seconds = run_on_threads(num_threads, [&atomic_counter, &locked_counter, use_atomic](size_t) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				if (use_atomic) {
+					atomic_counter.fetch_add(1, std::memory_order_relaxed);
+				}
+				else {
+					auto writelock_ptr = locked_counter.writelock_ptr();
+					writelock_ptr->set_value(writelock_ptr->value() + 1);
+				}
+			}
+		});
+		print_row(use_atomic ? "make_asyncsharedv2atomic<>() fetch_add()" : "writelock_ptr()", num_threads, double(num_threads * num_iterations), seconds);
+	}
+
+	void bench_atomic() {
+		std::cout << "atomic: increments of a shared counter" << std::endl;
+		std::cout << "  (shared object size: " << sizeof(std::atomic<long long>) << " bytes atomic vs. "
+			<< sizeof(mse::TAsyncSharedObj<CReadMostlyObj>) << " bytes locked)" << std::endl;
+		for (auto num_threads : thread_counts()) {
+			atomic_row(false, num_threads);
+			atomic_row(true, num_threads);
+		}
+	}
+
+#ifdef MSE_ASYNCSHARED_HAS_COROUTINES
+	mse::asyncshared_task coroutine_waiter(mse::TAsyncSharedReadWriteAccessRequester<CReadMostlyObj> access_requester, mse::async_lock_executor& executor, size_t num_iterations) {
+		for (size_t i = 0; i < num_iterations; i += 1) {
+			auto writelock_ptr = co_await access_requester.async_writelock_ptr(executor);
+			writelock_ptr->set_value(writelock_ptr->value() + 1);
+		}
+	}
+
+	void bench_coroutine_waiters() {
+		std::cout << "coroutine_waiters: many logical writers on one shared object, as coroutines on a few executor threads vs. as OS threads" << std::endl;
+		const size_t num_iterations = 200;
+		for (size_t num_waiters : { size_t(64), size_t(1024), size_t(4096) }) {
+			for (size_t num_executor_threads : { size_t(1), size_t(4) }) {
+				mse::async_lock_executor executor(num_executor_threads);
+				auto access_requester = mse::make_asyncsharedreadwrite<CReadMostlyObj>();
+				auto t1 = std::chrono::steady_clock::now();
+				std::vector<mse::asyncshared_task> tasks;
+				for (size_t i = 0; i < num_waiters; i += 1) {
+					tasks.push_back(coroutine_waiter(access_requester, executor, num_iterations));
+				}
+				for (const auto& task : tasks) {
+					task.wait();
+				}
+				auto t2 = std::chrono::steady_clock::now();
+				print_row(std::to_string(num_waiters) + " coroutines on " + std::to_string(num_executor_threads) + " executor threads", num_executor_threads,
+					double(num_waiters * num_iterations), std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count());
+			}
+			if (1024 >= num_waiters) {
+				auto access_requester = mse::make_asyncsharedreadwrite<CReadMostlyObj>();
+				auto seconds = run_on_threads(num_waiters, [&access_requester, num_iterations](size_t) {
+					for (size_t i = 0; i < num_iterations; i += 1) {
+						auto writelock_ptr = access_requester.writelock_ptr();
+						writelock_ptr->set_value(writelock_ptr->value() + 1);
+					}
+				});
+				print_row(std::to_string(num_waiters) + " OS threads, writelock_ptr()", num_waiters, double(num_waiters * num_iterations), seconds);
+			}
+		}
+	}
+#endif // MSE_ASYNCSHARED_HAS_COROUTINES
+
+	class CHotObj : public CReadMostlyObj {};
+	class CColdObj : public CReadMostlyObj {};
+
+	void bench_lock_metrics() {
+		std::cout << "lock_metrics: a heavily contended object and a lightly contended one, then the metrics of the hottest mutexes" << std::endl;
+		const size_t num_threads = 8;
+		const size_t num_iterations = 20000;
+		auto hot_access_requester = mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<CHotObj>();
+		auto cold_access_requester = mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<CColdObj>();
+		auto seconds = run_on_threads(num_threads, [&](size_t thread_index) {
+			for (size_t i = 0; i < num_iterations; i += 1) {
+				if (0 == (i + thread_index) % 4) {
+					auto writelock_ptr = hot_access_requester.writelock_ptr();
+					writelock_ptr->set_value(writelock_ptr->value() + 1);
+				}
+				else {
+					auto readlock_ptr = hot_access_requester.readlock_ptr();
+					/* and a recursive read lock */
+					(void)hot_access_requester.readlock_ptr()->value();
+				}
+				if ((0 == thread_index) && (0 == i % 100)) {
+					cold_access_requester.writelock_ptr()->set_value(int(i));
+				}
+			}
+		});
+		print_row("instrumented lock/unlock pairs", num_threads, double(num_threads * num_iterations), seconds);
+		if (!mse::lock_metrics_registry::enabled()) {
+			std::cout << "  (lock metrics are disabled, rebuild with -DMSE_ASYNCSHARED_LOCK_METRICS to see them)" << std::endl;
+			return;
+		}
+		mse::lock_metrics_registry::dump(std::cout, 2);
+		const auto hot_metrics = hot_access_requester.lock_metrics();
+		std::cout << "  hot object exclusive wait p99: <" << hot_metrics.m_exclusive_wait_times.percentile(0.99).count() << " ns" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const std::vector<std::pair<std::string, std::function<void()>>> benchmarks = {
+		{ "readlock_bookkeeping", bench_readlock_bookkeeping },
+		{ "read_mostly", bench_read_mostly },
+		{ "borrowed", bench_borrowed },
+		{ "lock_policy", bench_lock_policy },
+		{ "short_critical_sections", bench_short_critical_sections },
+		{ "spin_recovery", bench_spin_recovery },
+		{ "write_lock", bench_write_lock },
+		{ "timed_waits", bench_timed_waits },
+		{ "writer_latency", bench_writer_latency },
+		{ "priority", bench_priority },
+#ifdef MSE_ASYNCSHARED_HAS_STOP_TOKEN
+		{ "cancellation", bench_cancellation },
+#endif // MSE_ASYNCSHARED_HAS_STOP_TOKEN
+		{ "lock_metrics", bench_lock_metrics },
+		{ "read_check_write", bench_read_check_write },
+		{ "seqlock", bench_seqlock },
+		{ "snapshot", bench_snapshot },
+		{ "weak", bench_weak },
+		{ "transfer", bench_transfer },
+		{ "transact", bench_transact },
+		{ "flat_combining", bench_flat_combining },
+		{ "actor", bench_actor },
+		{ "atomic", bench_atomic },
+		{ "creation", bench_creation },
+		{ "immutable", bench_immutable },
+		{ "striped", bench_striped },
+		{ "release_mode_parity", bench_release_mode_parity },
+#ifdef MSE_ASYNCSHARED_HAS_COROUTINES
+		{ "coroutine_waiters", bench_coroutine_waiters },
+#endif // MSE_ASYNCSHARED_HAS_COROUTINES
+	};
+
+	for (const auto& benchmark : benchmarks) {
+		bool selected = (2 > argc);
+		for (int i = 1; i < argc; i += 1) {
+			if (benchmark.first == argv[i]) {
+				selected = true;
+			}
+		}
+		if (selected) {
+			benchmark.second();
+			std::cout << std::endl;
+		}
+	}
+	return 0;
+}
@@ -216,6 +216,45 @@ void main(int argc, char* argv[]) {
 			thread2.join();
 		}
 
+		std::cout << std::endl;
+	}
+	{
+		/* Rather than trying to obtain a write lock while holding a read lock (as above), a thread can obtain an
+		"upgradeable" read lock pointer, which can later be atomically upgraded to a write lock pointer. Only one
+		upgradeable pointer to the object can exist at a time (though it coexists with ordinary read lock pointers),
+		so two threads can't deadlock trying to upgrade at the same time. And because no other thread can modify the
+		object between the read and the upgrade, there's no need to re-read (and re-check) the object after the
+		upgrade. */
+
+		std::cout << "TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester upgradeable lock:";
+		std::cout << std::endl;
+
+		class CD {
+		public:
+			static void foo1(mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<A> A_ashar, int id) {
+				auto upgradeable_ptr = A_ashar.upgradeable_readlock_ptr();
+				std::this_thread::sleep_for(std::chrono::seconds(1));
+				if (7 <= upgradeable_ptr->b) {
+					/* The write lock pointer returned by upgrade() reverts to a read lock when it's destroyed. upgrade()
+					can only be called on a named upgradeable pointer (which has to outlive the write lock pointer), and
+					calling it again while the write lock pointer still exists would throw. */
+					auto writelock_ptr = upgradeable_ptr.upgrade();
+					writelock_ptr->b += id;
+				}
+				std::cout << "b: " << upgradeable_ptr->b;
+				std::cout << std::endl;
+			}
+		};
+
+		auto ash_access_requester = mse::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite<A>(7);
+
+		{
+			auto thread1 = mse::mstd::thread(CD::foo1, ash_access_requester, 1);
+			auto thread2 = mse::mstd::thread(CD::foo1, ash_access_requester, 2);
+			thread1.join();
+			thread2.join();
+		}
+
 		std::cout << std::endl;
 	}
 }
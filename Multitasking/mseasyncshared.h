@@ -9,9 +9,62 @@
 #define MSEASYNCSHARED_H_
 
 #include <shared_mutex>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <stdexcept>
 #include <unordered_map>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <ostream>
+#include <typeinfo>
+#include <tuple>
+#include <optional>
+#include <exception>
+#include <future>
+#include <system_error>
+#include <cstring>
+#include <cstdint>
 #include <cassert>
+#ifdef __linux__
+#include <sched.h>
+#include <ctime>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif // __linux__
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+/* The awaitable (coroutine) lock functions are available when compiling as C++20 (or later). */
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define MSE_ASYNCSHARED_HAS_COROUTINES
+#endif // __has_include(<coroutine>)
+#endif // defined(__cpp_impl_coroutine) && defined(__has_include)
+#ifdef MSE_ASYNCSHARED_HAS_COROUTINES
+#include <coroutine>
+#include <deque>
+#endif // MSE_ASYNCSHARED_HAS_COROUTINES
+
+/* The (cancellable) std::stop_token lock function overloads are available when compiling as C++20 (or later). */
+#ifdef __cpp_lib_jthread
+#define MSE_ASYNCSHARED_HAS_STOP_TOKEN
+#include <stop_token>
+#endif // __cpp_lib_jthread
+
+/* (Both the coroutine lock functions and the std::stop_token lock functions wait in the shared object's wait queue.) */
+#if defined(MSE_ASYNCSHARED_HAS_COROUTINES) || defined(MSE_ASYNCSHARED_HAS_STOP_TOKEN)
+#define MSE_ASYNCSHARED_HAS_LOCK_WAIT_QUEUE
+#endif // defined(MSE_ASYNCSHARED_HAS_COROUTINES) || defined(MSE_ASYNCSHARED_HAS_STOP_TOKEN)
 
 
 #if defined(MSE_SAFER_SUBSTITUTES_DISABLED) || defined(MSE_SAFERPTR_DISABLED)
@@ -21,7 +74,38 @@
 namespace mse {
 
 #ifdef MSE_ASYNCSHAREDPOINTER_DISABLED
+	/* In "disabled" (release) mode the lock pointers reduce to a std::unique_lock/std::shared_lock plus a raw pointer.
+	They don't hold a reference to the shared object (so they must not outlive every access requester to it), they have
+	no virtual destructor, and dereferencing them is unchecked (except by assert()). Pointers returned by the try_*()
+	functions must be tested (with operator bool()) before being dereferenced. */
+#define MSE_ASYNCSHARED_POINTER_DESTRUCTOR_PREFIX
+#define MSE_ASYNCSHARED_POINTER_CHECK_VALID(msg) assert(is_valid())
+
+	namespace impl {
+		template<class _TObj>
+		class TAsyncSharedObjPointerHolder {
+		public:
+			TAsyncSharedObjPointerHolder(const std::shared_ptr<_TObj>& shptr) : m_ptr(shptr.get()) {}
+			TAsyncSharedObjPointerHolder(const TAsyncSharedObjPointerHolder& src) = default;
+			TAsyncSharedObjPointerHolder(TAsyncSharedObjPointerHolder&& src) : m_ptr(src.m_ptr) { src.m_ptr = nullptr; }
+			TAsyncSharedObjPointerHolder& operator=(std::nullptr_t) { m_ptr = nullptr; return (*this); }
+			explicit operator bool() const { return (nullptr != m_ptr); }
+			_TObj& operator*() const { return (*m_ptr); }
+			_TObj* operator->() const { return m_ptr; }
+		private:
+			_TObj* m_ptr = nullptr;
+		};
+	}
 #else /*MSE_ASYNCSHAREDPOINTER_DISABLED*/
+#define MSE_ASYNCSHARED_POINTER_DESTRUCTOR_PREFIX virtual
+#define MSE_ASYNCSHARED_POINTER_CHECK_VALID(msg) if (!is_valid()) { throw(std::out_of_range(msg)); }
+
+	namespace impl {
+		/* The lock pointers hold a reference to the shared object so that they remain valid even if all the access
+		requesters are gone. */
+		template<class _TObj>
+		using TAsyncSharedObjPointerHolder = std::shared_ptr<_TObj>;
+	}
 #endif /*MSE_ASYNCSHAREDPOINTER_DISABLED*/
 
 	/* This macro roughly simulates constructor inheritance. Originally it was used when some compilers didn't support
@@ -50,24 +134,788 @@ namespace mse {
 		std::string m_what;
 	};
 
-	class recursive_shared_timed_mutex : private std::shared_timed_mutex {
+	namespace impl {
+		/* A per-thread record of the (recursive) lock counts the thread holds on each mutex. Lookups are a linear search
+		of a small fixed array, which should cover the common case of a thread holding locks on only a few objects at a
+		time. Only when that's not the case do the entries overflow into a (heap allocated) hash map. */
+		class CThreadLocalLockCounts {
+		public:
+			class CEntry {
+			public:
+				const void* m_mutex_ptr = nullptr;
+				int m_readlock_count = 0;
+				/* Used by mutexes that don't otherwise record which thread owns the write lock. */
+				int m_writelock_count = 0;
+				/* Used by mutexes that need to remember which of their (reader) slots the thread is registered in. */
+				size_t m_reader_slot_index = 0;
+#ifdef MSE_ASYNCSHARED_LOCK_METRICS
+				/* Used by the lock metrics to time how long (non-exclusive) locks are held. */
+				std::chrono::steady_clock::time_point m_hold_start_time;
+#endif // MSE_ASYNCSHARED_LOCK_METRICS
+			};
+
+			CEntry* find(const void* mutex_ptr) {
+				for (size_t i = 0; i < m_num_fast_entries; i += 1) {
+					if (mutex_ptr == m_fast_entries[i].m_mutex_ptr) {
+						return &(m_fast_entries[i]);
+					}
+				}
+				if (!m_overflow_entries.empty()) {
+					const auto found_it = m_overflow_entries.find(mutex_ptr);
+					if (m_overflow_entries.end() != found_it) {
+						return &((*found_it).second);
+					}
+				}
+				return nullptr;
+			}
+			CEntry& find_or_insert(const void* mutex_ptr) {
+				auto entry_ptr = find(mutex_ptr);
+				if (entry_ptr) {
+					return (*entry_ptr);
+				}
+				if (sc_max_fast_entries > m_num_fast_entries) {
+					auto& entry_ref = m_fast_entries[m_num_fast_entries];
+					m_num_fast_entries += 1;
+					entry_ref = CEntry();
+					entry_ref.m_mutex_ptr = mutex_ptr;
+					return entry_ref;
+				}
+				auto& entry_ref = m_overflow_entries[mutex_ptr];
+				entry_ref.m_mutex_ptr = mutex_ptr;
+				return entry_ref;
+			}
+			void erase(const void* mutex_ptr) {
+				for (size_t i = 0; i < m_num_fast_entries; i += 1) {
+					if (mutex_ptr == m_fast_entries[i].m_mutex_ptr) {
+						m_num_fast_entries -= 1;
+						m_fast_entries[i] = m_fast_entries[m_num_fast_entries];
+						m_fast_entries[m_num_fast_entries] = CEntry();
+						return;
+					}
+				}
+				m_overflow_entries.erase(mutex_ptr);
+			}
+
+		private:
+			static const size_t sc_max_fast_entries = 8;
+			CEntry m_fast_entries[sc_max_fast_entries];
+			size_t m_num_fast_entries = 0;
+			std::unordered_map<const void*, CEntry> m_overflow_entries;
+		};
+
+		inline CThreadLocalLockCounts& tl_lock_counts() {
+			thread_local CThreadLocalLockCounts tl_lock_counts_obj;
+			return tl_lock_counts_obj;
+		}
+
+		/* A hint to the processor that we're in a spin-wait loop. */
+		inline void cpu_relax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+			_mm_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+			__builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__aarch64__) || defined(__arm__))
+			__asm__ __volatile__("yield");
+#endif
+		}
+
+		static const size_t sc_cache_line_size = 64;
+	}
+
+	/* Lock request priority classes. (See rw_fairness::priority_classes.) */
+	enum class priority { low = 0, normal = 1, high = 2 };
+
+	namespace impl {
+		static const size_t sc_num_priority_classes = 3;
+
+		inline priority& tl_lock_priority() {
+			thread_local priority tl_lock_priority_obj = priority::normal;
+			return tl_lock_priority_obj;
+		}
+	}
+
+	/* Sets the priority of the lock requests the current thread makes during the scoped_lock_priority's lifetime (for
+	example, for the duration of handling a latency sensitive request). The access requesters' writelock_ptr(priority)
+	and readlock_ptr(priority) overloads use it. */
+	class scoped_lock_priority {
+	public:
+		scoped_lock_priority(priority lock_priority) : m_previous_priority(impl::tl_lock_priority()) {
+			impl::tl_lock_priority() = lock_priority;
+		}
+		~scoped_lock_priority() {
+			impl::tl_lock_priority() = m_previous_priority;
+		}
+	private:
+		scoped_lock_priority(const scoped_lock_priority&) = delete;
+		scoped_lock_priority& operator=(const scoped_lock_priority&) = delete;
+
+		priority m_previous_priority;
+	};
+
+	/* Fairness policies for the (non-recursive) shared mutex underlying basic_recursive_shared_timed_mutex<>. */
+	namespace rw_fairness {
+		/* Whatever the platform's std::shared_timed_mutex does. */
+		class platform_default {};
+		/* Readers are admitted whenever no writer holds the lock. A steady stream of readers can starve writers. */
+		class reader_preferring {};
+		/* Once a writer is waiting, newly arriving readers are held back until it has been served. A steady stream of
+		writers can starve readers. */
+		class writer_preferring {};
+		/* Readers and writers alternate "phases". A waiting writer holds back newly arriving readers, but when a writer
+		releases the lock, all the readers that were waiting at that moment are admitted before the next writer. Neither
+		side can starve the other. */
+		class phase_fair {};
+		/* Waiting lock requests of a higher priority class (see mse::priority) are granted before those of lower
+		classes. But classes are aged: once a (small, fixed) number of other requests have been admitted since a class's
+		waiting requests were first bypassed, that class is served next. If several classes are in that state, the one
+		that was bypassed first goes first. So no class waits for more than a bounded number of admissions of other
+		classes. Within a class, readers and writers alternate phases as with phase_fair, so neither starves the other.
+		Note that only the fair_shared_timed_mutex<> based mutexes (such as
+		priority_recursive_shared_timed_mutex) honor priorities. With other mutex types they're ignored. */
+		class priority_classes {};
+	}
+
+	/* A shared timed mutex (built on a mutex and condition variables) that admits readers and writers according to the
+	given fairness policy. */
+	template<class _TFairnessPolicy>
+	class fair_shared_timed_mutex {
 	public:
-		typedef std::shared_timed_mutex base_class;
+		fair_shared_timed_mutex() {}
+		fair_shared_timed_mutex(const fair_shared_timed_mutex&) = delete;
+		fair_shared_timed_mutex& operator=(const fair_shared_timed_mutex&) = delete;
+
+		void lock()
+		{	// lock exclusive
+			std::unique_lock<std::mutex> lock1(m_state_mutex);
+			const auto lock_priority = request_priority();
+			add_waiting_writer(lock_priority);
+			m_writer_cv.wait(lock1, [this, lock_priority]() { return writer_may_enter(lock_priority); });
+			remove_waiting_writer(lock_priority);
+			admit_writer(lock_priority);
+		}
+
+		bool try_lock()
+		{	// try to lock exclusive
+			std::lock_guard<std::mutex> lock1(m_state_mutex);
+			const auto lock_priority = request_priority();
+			if (!writer_may_enter(lock_priority)) {
+				return false;
+			}
+			admit_writer(lock_priority);
+			return true;
+		}
+
+		template<class _Rep, class _Period>
+		bool try_lock_for(const std::chrono::duration<_Rep, _Period>& _Rel_time)
+		{	// try to lock for duration
+			return (try_lock_until(std::chrono::steady_clock::now() + _Rel_time));
+		}
+
+		template<class _Clock, class _Duration>
+		bool try_lock_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time)
+		{	// try to lock until time point
+			std::unique_lock<std::mutex> lock1(m_state_mutex);
+			const auto lock_priority = request_priority();
+			add_waiting_writer(lock_priority);
+			const bool retval = m_writer_cv.wait_until(lock1, _Abs_time, [this, lock_priority]() { return writer_may_enter(lock_priority); });
+			remove_waiting_writer(lock_priority);
+			if (!retval) {
+				/* We may have been holding back readers (or, with priority classes, writers). */
+				lock1.unlock();
+				m_reader_cv.notify_all();
+				if (sc_has_priority_classes) {
+					m_writer_cv.notify_all();
+				}
+				return false;
+			}
+			admit_writer(lock_priority);
+			return true;
+		}
+
+		void unlock()
+		{	// unlock exclusive
+			{
+				std::lock_guard<std::mutex> lock1(m_state_mutex);
+				assert(m_writer_active);
+				m_writer_active = false;
+				if (sc_is_phase_fair) {
+					/* The readers (of the writer's class) waiting at this point get to go before the next writer (of
+					that class). */
+					const auto priority_class = size_t(m_active_writer_priority);
+					m_phase_by_class[priority_class] += 1;
+					m_num_phase_admitted_readers_by_class[priority_class] = m_num_waiting_readers_by_class[priority_class];
+				}
+			}
+			m_reader_cv.notify_all();
+			m_writer_cv.notify_all();
+		}
+
+		void lock_shared()
+		{	// lock non-exclusive
+			std::unique_lock<std::mutex> lock1(m_state_mutex);
+			const auto lock_priority = request_priority();
+			const auto arrival_phase = m_phase_by_class[size_t(lock_priority)];
+			add_waiting_reader(lock_priority);
+			m_reader_cv.wait(lock1, [this, arrival_phase, lock_priority]() { return reader_may_enter(arrival_phase, lock_priority); });
+			remove_waiting_reader(lock_priority);
+			admit_reader(arrival_phase, lock_priority);
+			if (sc_has_priority_classes) {
+				/* (Readers of other classes that were waiting on this one may now be able to enter.) */
+				lock1.unlock();
+				m_reader_cv.notify_all();
+			}
+		}
+
+		bool try_lock_shared()
+		{	// try to lock non-exclusive
+			std::unique_lock<std::mutex> lock1(m_state_mutex);
+			const auto lock_priority = request_priority();
+			const auto arrival_phase = m_phase_by_class[size_t(lock_priority)];
+			if (!reader_may_enter(arrival_phase, lock_priority)) {
+				return false;
+			}
+			admit_reader(arrival_phase, lock_priority);
+			if (sc_has_priority_classes && (1 <= m_num_waiting_readers)) {
+				lock1.unlock();
+				m_reader_cv.notify_all();
+			}
+			return true;
+		}
+
+		template<class _Rep, class _Period>
+		bool try_lock_shared_for(const std::chrono::duration<_Rep, _Period>& _Rel_time)
+		{	// try to lock non-exclusive for relative time
+			return (try_lock_shared_until(_Rel_time + std::chrono::steady_clock::now()));
+		}
+
+		template<class _Clock, class _Duration>
+		bool try_lock_shared_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time)
+		{	// try to lock non-exclusive until absolute time
+			std::unique_lock<std::mutex> lock1(m_state_mutex);
+			const auto lock_priority = request_priority();
+			const auto priority_class = size_t(lock_priority);
+			const auto arrival_phase = m_phase_by_class[priority_class];
+			add_waiting_reader(lock_priority);
+			const bool retval = m_reader_cv.wait_until(lock1, _Abs_time, [this, arrival_phase, lock_priority]() { return reader_may_enter(arrival_phase, lock_priority); });
+			remove_waiting_reader(lock_priority);
+			if (!retval) {
+				bool notify_writers = false;
+				if ((arrival_phase != m_phase_by_class[priority_class]) && (1 <= m_num_phase_admitted_readers_by_class[priority_class])) {
+					m_num_phase_admitted_readers_by_class[priority_class] -= 1;
+					notify_writers = (0 == m_num_phase_admitted_readers_by_class[priority_class]);
+				}
+				lock1.unlock();
+				if (sc_has_priority_classes) {
+					/* We may have been holding back requests of other classes. */
+					m_reader_cv.notify_all();
+					m_writer_cv.notify_all();
+				}
+				else if (notify_writers) {
+					m_writer_cv.notify_all();
+				}
+				return false;
+			}
+			admit_reader(arrival_phase, lock_priority);
+			if (sc_has_priority_classes) {
+				lock1.unlock();
+				m_reader_cv.notify_all();
+			}
+			return true;
+		}
+
+		void unlock_shared()
+		{	// unlock non-exclusive
+			bool notify_writers = false;
+			{
+				std::lock_guard<std::mutex> lock1(m_state_mutex);
+				assert(1 <= m_num_active_readers);
+				m_num_active_readers -= 1;
+				notify_writers = ((0 == m_num_active_readers) && (1 <= m_num_waiting_writers));
+			}
+			if (notify_writers) {
+				m_writer_cv.notify_all();
+			}
+		}
+
+	private:
+		static const bool sc_has_priority_classes = std::is_same<_TFairnessPolicy, rw_fairness::priority_classes>::value;
+		/* (Within each priority class, readers and writers alternate phases.) */
+		static const bool sc_is_phase_fair = (std::is_same<_TFairnessPolicy, rw_fairness::phase_fair>::value || sc_has_priority_classes);
+		/* (priority_classes only) the number of (other) requests that can be admitted after a class with waiting
+		requests was first bypassed before that class is considered starved */
+		static const unsigned long long sc_max_num_bypasses = 8;
+		static const unsigned long long sc_not_bypassed = ~0ULL;
+
+		static priority request_priority() {
+			return sc_has_priority_classes ? impl::tl_lock_priority() : priority::normal;
+		}
+		void add_waiting_writer(priority lock_priority) {
+			m_num_waiting_writers += 1;
+			m_num_waiting_writers_by_class[size_t(lock_priority)] += 1;
+		}
+		void remove_waiting_writer(priority lock_priority) {
+			m_num_waiting_writers -= 1;
+			m_num_waiting_writers_by_class[size_t(lock_priority)] -= 1;
+		}
+		void add_waiting_reader(priority lock_priority) {
+			m_num_waiting_readers += 1;
+			m_num_waiting_readers_by_class[size_t(lock_priority)] += 1;
+		}
+		void remove_waiting_reader(priority lock_priority) {
+			m_num_waiting_readers -= 1;
+			m_num_waiting_readers_by_class[size_t(lock_priority)] -= 1;
+		}
+		size_t num_waiting(size_t priority_class) const {
+			return m_num_waiting_writers_by_class[priority_class] + m_num_waiting_readers_by_class[priority_class];
+		}
+		/* (priority_classes only) */
+		bool is_starved(size_t priority_class) const {
+			const auto first_bypassed_at = m_first_bypassed_at_by_class[priority_class];
+			return ((1 <= num_waiting(priority_class)) && (sc_not_bypassed != first_bypassed_at)
+				&& (sc_max_num_bypasses <= (m_num_admissions - first_bypassed_at)));
+		}
+		/* (priority_classes only) Whether a request of the given class would take precedence over the waiting requests. */
+		bool priority_class_may_enter(priority lock_priority) const {
+			if (!sc_has_priority_classes) {
+				return true;
+			}
+			const auto priority_class = size_t(lock_priority);
+			/* If any classes are starved, the one that was first bypassed the longest ago goes first (the higher class, in
+			case of a tie). */
+			size_t starved_class = impl::sc_num_priority_classes;
+			for (size_t i = impl::sc_num_priority_classes; 1 <= i; i -= 1) {
+				if (is_starved(i - 1) && ((impl::sc_num_priority_classes == starved_class)
+					|| (m_first_bypassed_at_by_class[i - 1] < m_first_bypassed_at_by_class[starved_class]))) {
+					starved_class = i - 1;
+				}
+			}
+			if (impl::sc_num_priority_classes != starved_class) {
+				return (priority_class == starved_class);
+			}
+			for (size_t i = priority_class + 1; i < impl::sc_num_priority_classes; i += 1) {
+				if (1 <= num_waiting(i)) {
+					return false;
+				}
+			}
+			return true;
+		}
+		/* (priority_classes only) Ages the classes with waiting requests that this admission bypasses. */
+		void on_priority_request_admitted(priority lock_priority) {
+			if (sc_has_priority_classes) {
+				for (size_t i = 0; i < impl::sc_num_priority_classes; i += 1) {
+					if ((size_t(lock_priority) == i) || (0 == num_waiting(i))) {
+						m_first_bypassed_at_by_class[i] = sc_not_bypassed;
+					}
+					else if (sc_not_bypassed == m_first_bypassed_at_by_class[i]) {
+						m_first_bypassed_at_by_class[i] = m_num_admissions;
+					}
+				}
+				m_num_admissions += 1;
+			}
+		}
+
+		bool writer_may_enter(priority lock_priority) const {
+			return ((!m_writer_active) && (0 == m_num_active_readers)
+				&& (0 == m_num_phase_admitted_readers_by_class[size_t(lock_priority)])
+				&& priority_class_may_enter(lock_priority));
+		}
+		bool reader_may_enter(unsigned long long arrival_phase, priority lock_priority) const {
+			if (m_writer_active) {
+				return false;
+			}
+			if (sc_is_phase_fair) {
+				const auto priority_class = size_t(lock_priority);
+				return (priority_class_may_enter(lock_priority) && ((0 == m_num_waiting_writers_by_class[priority_class])
+					|| (arrival_phase != m_phase_by_class[priority_class])));
+			}
+			else if (std::is_same<_TFairnessPolicy, rw_fairness::writer_preferring>::value) {
+				return (0 == m_num_waiting_writers);
+			}
+			else {
+				static_assert(std::is_same<_TFairnessPolicy, rw_fairness::reader_preferring>::value
+					|| std::is_same<_TFairnessPolicy, rw_fairness::writer_preferring>::value
+					|| std::is_same<_TFairnessPolicy, rw_fairness::phase_fair>::value
+					|| std::is_same<_TFairnessPolicy, rw_fairness::priority_classes>::value, "unsupported fairness policy - mse::fair_shared_timed_mutex");
+				return true;
+			}
+		}
+		void admit_writer(priority lock_priority) {
+			m_writer_active = true;
+			m_active_writer_priority = lock_priority;
+			on_priority_request_admitted(lock_priority);
+		}
+		void admit_reader(unsigned long long arrival_phase, priority lock_priority) {
+			const auto priority_class = size_t(lock_priority);
+			m_num_active_readers += 1;
+			if ((arrival_phase != m_phase_by_class[priority_class]) && (1 <= m_num_phase_admitted_readers_by_class[priority_class])) {
+				m_num_phase_admitted_readers_by_class[priority_class] -= 1;
+			}
+			on_priority_request_admitted(lock_priority);
+		}
+
+		std::mutex m_state_mutex;
+		std::condition_variable m_reader_cv;
+		std::condition_variable m_writer_cv;
+		bool m_writer_active = false;
+		priority m_active_writer_priority = priority::normal;
+		size_t m_num_active_readers = 0;
+		size_t m_num_waiting_readers = 0;
+		size_t m_num_waiting_writers = 0;
+		std::array<size_t, impl::sc_num_priority_classes> m_num_waiting_writers_by_class = {};
+		std::array<size_t, impl::sc_num_priority_classes> m_num_waiting_readers_by_class = {};
+		/* (phase_fair and priority_classes only) Per priority class (only the "normal" one is used without priority
+		classes), the current phase, and the number of readers, admitted at the end of the last write phase, yet to
+		enter. */
+		std::array<unsigned long long, impl::sc_num_priority_classes> m_phase_by_class = {};
+		std::array<size_t, impl::sc_num_priority_classes> m_num_phase_admitted_readers_by_class = {};
+		/* (priority_classes only) the number of requests admitted so far, and, for each class, the value it had when
+		the class's waiting requests were first bypassed (or sc_not_bypassed) */
+		unsigned long long m_num_admissions = 0;
+		std::array<unsigned long long, impl::sc_num_priority_classes> m_first_bypassed_at_by_class = { sc_not_bypassed, sc_not_bypassed, sc_not_bypassed };
+	};
+
+	namespace impl {
+		template<class _TFairnessPolicy>
+		struct shared_timed_mutex_for_fairness_policy {
+			typedef fair_shared_timed_mutex<_TFairnessPolicy> type;
+		};
+		template<>
+		struct shared_timed_mutex_for_fairness_policy<rw_fairness::platform_default> {
+			typedef std::shared_timed_mutex type;
+		};
+	}
+
+	/* A histogram of lock wait or hold times, with (power of two) nanosecond buckets. Bucket i counts the durations in
+	[2^i, 2^(i+1)) nanoseconds (with bucket 0 also counting zero durations). */
+	class lock_time_histogram_snapshot {
+	public:
+		static const size_t sc_num_buckets = 40;
+
+		unsigned long long count() const {
+			unsigned long long retval = 0;
+			for (const auto& count_cref : m_counts) { retval += count_cref; }
+			return retval;
+		}
+		std::chrono::nanoseconds mean() const {
+			const auto l_count = count();
+			return std::chrono::nanoseconds((0 == l_count) ? 0 : (m_total.count() / (long long)l_count));
+		}
+		/* Returns (the upper bound of the bucket containing) the given percentile, e.g. percentile(0.99). */
+		std::chrono::nanoseconds percentile(double fraction) const {
+			const auto l_count = count();
+			if (0 == l_count) {
+				return std::chrono::nanoseconds(0);
+			}
+			const auto target = (unsigned long long)(fraction * double(l_count - 1)) + 1;
+			unsigned long long cumulative_count = 0;
+			for (size_t i = 0; i < sc_num_buckets; i += 1) {
+				cumulative_count += m_counts[i];
+				if (cumulative_count >= target) {
+					return std::chrono::nanoseconds((2LL << i) - 1);
+				}
+			}
+			return std::chrono::nanoseconds((2LL << (sc_num_buckets - 1)) - 1);
+		}
+
+		std::array<unsigned long long, sc_num_buckets> m_counts = {};
+		std::chrono::nanoseconds m_total = std::chrono::nanoseconds(0);
+	};
+
+	/* A snapshot of the statistics recorded by a mutex when lock metrics are enabled (see MSE_ASYNCSHARED_LOCK_METRICS). */
+	class lock_metrics_snapshot {
+	public:
+		/* identifies the mutex (and so the shared object) the metrics belong to */
+		const void* m_mutex_ptr = nullptr;
+		/* for mutexes embedded in shared objects, the (implementation defined) name of the shared object's type */
+		const char* m_label = "";
+
+		unsigned long long m_num_exclusive_acquisitions = 0;
+		unsigned long long m_num_shared_acquisitions = 0;
+		/* acquisitions by threads that already held the lock */
+		unsigned long long m_num_recursive_reentries = 0;
+		unsigned long long m_num_try_lock_failures = 0;
+
+		lock_time_histogram_snapshot m_exclusive_wait_times;
+		lock_time_histogram_snapshot m_shared_wait_times;
+		lock_time_histogram_snapshot m_exclusive_hold_times;
+		lock_time_histogram_snapshot m_shared_hold_times;
+
+		std::chrono::nanoseconds total_wait_time() const { return m_exclusive_wait_times.m_total + m_shared_wait_times.m_total; }
+
+		void print(std::ostream& os) const {
+			os << m_label << " (mutex at " << m_mutex_ptr << "): "
+				<< "exclusive acquisitions: " << m_num_exclusive_acquisitions
+				<< ", shared acquisitions: " << m_num_shared_acquisitions
+				<< ", recursive reentries: " << m_num_recursive_reentries
+				<< ", try_lock failures: " << m_num_try_lock_failures
+				<< ", total wait: " << total_wait_time().count() << "ns\n";
+			print_histogram(os, "exclusive wait", m_exclusive_wait_times);
+			print_histogram(os, "shared wait", m_shared_wait_times);
+			print_histogram(os, "exclusive hold", m_exclusive_hold_times);
+			print_histogram(os, "shared hold", m_shared_hold_times);
+		}
+
+	private:
+		static void print_histogram(std::ostream& os, const char* name, const lock_time_histogram_snapshot& histogram) {
+			os << "    " << name << " times: count " << histogram.count() << ", mean " << histogram.mean().count()
+				<< "ns, p50 <" << histogram.percentile(0.5).count() << "ns, p99 <" << histogram.percentile(0.99).count()
+				<< "ns, max <" << histogram.percentile(1.0).count() << "ns\n";
+		}
+	};
+
+#ifdef MSE_ASYNCSHARED_LOCK_METRICS
+	namespace impl {
+		class CLockTimeHistogram {
+		public:
+			void record(std::chrono::nanoseconds duration) {
+				auto ns = duration.count();
+				if (0 > ns) { ns = 0; }
+				size_t bucket_index = 0;
+				while ((lock_time_histogram_snapshot::sc_num_buckets - 1 > bucket_index) && ((2LL << bucket_index) <= ns)) {
+					bucket_index += 1;
+				}
+				m_counts[bucket_index].fetch_add(1, std::memory_order_relaxed);
+				m_total_ns.fetch_add(ns, std::memory_order_relaxed);
+			}
+			lock_time_histogram_snapshot snapshot() const {
+				lock_time_histogram_snapshot retval;
+				for (size_t i = 0; i < lock_time_histogram_snapshot::sc_num_buckets; i += 1) {
+					retval.m_counts[i] = m_counts[i].load(std::memory_order_relaxed);
+				}
+				retval.m_total = std::chrono::nanoseconds(m_total_ns.load(std::memory_order_relaxed));
+				return retval;
+			}
+
+		private:
+			std::array<std::atomic<unsigned long long>, lock_time_histogram_snapshot::sc_num_buckets> m_counts = {};
+			std::atomic<long long> m_total_ns{ 0 };
+		};
+
+		/* The metrics recorded by (an instrumented) mutex. Each instance registers itself in a global list (for the
+		lifetime of the mutex) so that the metrics of all the mutexes can be enumerated. */
+		class CLockMetrics {
+		public:
+			CLockMetrics(const void* mutex_ptr) : m_mutex_ptr(mutex_ptr) { registry_add(this); }
+			~CLockMetrics() { registry_remove(this); }
+			CLockMetrics(const CLockMetrics&) = delete;
+			CLockMetrics& operator=(const CLockMetrics&) = delete;
+
+			void set_label(const char* label) { m_label.store(label, std::memory_order_relaxed); }
+
+			void on_recursive_reentry() { m_num_recursive_reentries.fetch_add(1, std::memory_order_relaxed); }
+			void on_try_lock_failure() { m_num_try_lock_failures.fetch_add(1, std::memory_order_relaxed); }
+			/* must be called by the (new) owner of the exclusive lock */
+			void on_exclusive_acquired(std::chrono::steady_clock::time_point wait_start_time) {
+				const auto now = std::chrono::steady_clock::now();
+				m_num_exclusive_acquisitions.fetch_add(1, std::memory_order_relaxed);
+				m_exclusive_wait_times.record(now - wait_start_time);
+				m_exclusive_hold_start_time = now;
+			}
+			/* must be called by the owner of the exclusive lock, before it releases it */
+			void on_exclusive_released() {
+				m_exclusive_hold_times.record(std::chrono::steady_clock::now() - m_exclusive_hold_start_time);
+			}
+			void on_shared_acquired(std::chrono::steady_clock::time_point wait_start_time) {
+				const auto now = std::chrono::steady_clock::now();
+				m_num_shared_acquisitions.fetch_add(1, std::memory_order_relaxed);
+				m_shared_wait_times.record(now - wait_start_time);
+				try {
+					tl_lock_counts().find_or_insert(this).m_hold_start_time = now;
+				}
+				catch (...) {
+					/* The metrics are best effort. */
+				}
+			}
+			void on_shared_released() {
+				const auto entry_ptr = tl_lock_counts().find(this);
+				if (entry_ptr) {
+					m_shared_hold_times.record(std::chrono::steady_clock::now() - entry_ptr->m_hold_start_time);
+					tl_lock_counts().erase(this);
+				}
+			}
+
+			lock_metrics_snapshot snapshot() const {
+				lock_metrics_snapshot retval;
+				retval.m_mutex_ptr = m_mutex_ptr;
+				retval.m_label = m_label.load(std::memory_order_relaxed);
+				retval.m_num_exclusive_acquisitions = m_num_exclusive_acquisitions.load(std::memory_order_relaxed);
+				retval.m_num_shared_acquisitions = m_num_shared_acquisitions.load(std::memory_order_relaxed);
+				retval.m_num_recursive_reentries = m_num_recursive_reentries.load(std::memory_order_relaxed);
+				retval.m_num_try_lock_failures = m_num_try_lock_failures.load(std::memory_order_relaxed);
+				retval.m_exclusive_wait_times = m_exclusive_wait_times.snapshot();
+				retval.m_shared_wait_times = m_shared_wait_times.snapshot();
+				retval.m_exclusive_hold_times = m_exclusive_hold_times.snapshot();
+				retval.m_shared_hold_times = m_shared_hold_times.snapshot();
+				return retval;
+			}
+
+			static std::vector<lock_metrics_snapshot> snapshot_all() {
+				std::vector<lock_metrics_snapshot> retval;
+				auto& registry_ref = registry();
+				std::lock_guard<std::mutex> lock1(registry_ref.m_mutex);
+				for (auto metrics_ptr = registry_ref.m_first_ptr; metrics_ptr; metrics_ptr = metrics_ptr->m_next_ptr) {
+					retval.push_back(metrics_ptr->snapshot());
+				}
+				return retval;
+			}
+
+		private:
+			class CRegistry {
+			public:
+				std::mutex m_mutex;
+				CLockMetrics* m_first_ptr = nullptr;
+			};
+			static CRegistry& registry() {
+				static CRegistry s_registry;
+				return s_registry;
+			}
+			static void registry_add(CLockMetrics* metrics_ptr) {
+				auto& registry_ref = registry();
+				std::lock_guard<std::mutex> lock1(registry_ref.m_mutex);
+				metrics_ptr->m_next_ptr = registry_ref.m_first_ptr;
+				if (registry_ref.m_first_ptr) {
+					registry_ref.m_first_ptr->m_prev_ptr = metrics_ptr;
+				}
+				registry_ref.m_first_ptr = metrics_ptr;
+			}
+			static void registry_remove(CLockMetrics* metrics_ptr) {
+				auto& registry_ref = registry();
+				std::lock_guard<std::mutex> lock1(registry_ref.m_mutex);
+				if (metrics_ptr->m_prev_ptr) {
+					metrics_ptr->m_prev_ptr->m_next_ptr = metrics_ptr->m_next_ptr;
+				}
+				else {
+					registry_ref.m_first_ptr = metrics_ptr->m_next_ptr;
+				}
+				if (metrics_ptr->m_next_ptr) {
+					metrics_ptr->m_next_ptr->m_prev_ptr = metrics_ptr->m_prev_ptr;
+				}
+			}
+
+			const void* m_mutex_ptr = nullptr;
+			std::atomic<const char*> m_label{ "" };
+			std::atomic<unsigned long long> m_num_exclusive_acquisitions{ 0 };
+			std::atomic<unsigned long long> m_num_shared_acquisitions{ 0 };
+			std::atomic<unsigned long long> m_num_recursive_reentries{ 0 };
+			std::atomic<unsigned long long> m_num_try_lock_failures{ 0 };
+			CLockTimeHistogram m_exclusive_wait_times;
+			CLockTimeHistogram m_shared_wait_times;
+			CLockTimeHistogram m_exclusive_hold_times;
+			CLockTimeHistogram m_shared_hold_times;
+			std::chrono::steady_clock::time_point m_exclusive_hold_start_time;
+
+			CLockMetrics* m_prev_ptr = nullptr;
+			CLockMetrics* m_next_ptr = nullptr;
+		};
+	}
+#endif // MSE_ASYNCSHARED_LOCK_METRICS
+
+	/* When MSE_ASYNCSHARED_LOCK_METRICS is defined, (basic_)recursive_shared_timed_mutexes (and so, by default, the
+	mutexes of the TAsyncShared objects) record their acquisitions, recursive reentries, try_lock failures, and wait and
+	hold time histograms. The metrics of every live mutex can be obtained with lock_metrics_registry::snapshot_all(), or
+	printed, "hottest" (i.e. highest total wait time) first, with lock_metrics_registry::dump(). The metrics of an
+	individual shared object can be obtained from its access requesters' lock_metrics() member function. */
+	class lock_metrics_registry {
+	public:
+		static bool enabled() {
+#ifdef MSE_ASYNCSHARED_LOCK_METRICS
+			return true;
+#else // MSE_ASYNCSHARED_LOCK_METRICS
+			return false;
+#endif // MSE_ASYNCSHARED_LOCK_METRICS
+		}
+		static std::vector<lock_metrics_snapshot> snapshot_all() {
+#ifdef MSE_ASYNCSHARED_LOCK_METRICS
+			return impl::CLockMetrics::snapshot_all();
+#else // MSE_ASYNCSHARED_LOCK_METRICS
+			return std::vector<lock_metrics_snapshot>();
+#endif // MSE_ASYNCSHARED_LOCK_METRICS
+		}
+		static void dump(std::ostream& os, size_t max_num_mutexes = 20) {
+			auto snapshots = snapshot_all();
+			std::sort(snapshots.begin(), snapshots.end(), [](const lock_metrics_snapshot& a, const lock_metrics_snapshot& b) {
+				return a.total_wait_time() > b.total_wait_time();
+			});
+			if (snapshots.size() > max_num_mutexes) {
+				snapshots.resize(max_num_mutexes);
+			}
+			for (const auto& snapshot_cref : snapshots) {
+				snapshot_cref.print(os);
+			}
+		}
+	};
+
+	template<class _TFairnessPolicy = rw_fairness::platform_default>
+	class basic_recursive_shared_timed_mutex : private impl::shared_timed_mutex_for_fairness_policy<_TFairnessPolicy>::type {
+	public:
+		typedef typename impl::shared_timed_mutex_for_fairness_policy<_TFairnessPolicy>::type base_class;
+		typedef _TFairnessPolicy fairness_policy_type;
+
+		basic_recursive_shared_timed_mutex() {}
+		basic_recursive_shared_timed_mutex(const basic_recursive_shared_timed_mutex&) = delete;
+		basic_recursive_shared_timed_mutex& operator=(const basic_recursive_shared_timed_mutex&) = delete;
+
+		/* (See MSE_ASYNCSHARED_LOCK_METRICS.) */
+		lock_metrics_snapshot lock_metrics() const {
+#ifdef MSE_ASYNCSHARED_LOCK_METRICS
+			return m_metrics.snapshot();
+#else // MSE_ASYNCSHARED_LOCK_METRICS
+			lock_metrics_snapshot retval;
+			retval.m_mutex_ptr = this;
+			return retval;
+#endif // MSE_ASYNCSHARED_LOCK_METRICS
+		}
+		void set_lock_metrics_label(const char* label) {
+#ifdef MSE_ASYNCSHARED_LOCK_METRICS
+			m_metrics.set_label(label);
+#else // MSE_ASYNCSHARED_LOCK_METRICS
+			(void)label;
+#endif // MSE_ASYNCSHARED_LOCK_METRICS
+		}
+
+		/* In "adaptive" mode, a thread that finds the mutex unavailable in lock() or lock_shared() spins (with exponential
+		backoff) for a while before parking (i.e. blocking in the underlying shared_timed_mutex), betting that the current
+		holder will release it soon. The spin budget is learned from how long recent spinning acquisitions actually had to
+		wait (i.e. roughly the remaining hold times of the holders), so that where critical sections are short the spinning
+		usually succeeds and avoids the cost of a context switch, and where they're long threads give up and park quickly.
+		Every so often a spin uses the maximum budget instead (a "probe"), so that if critical sections get short again
+		after a period of long ones, the budget recovers. Adaptive mode is off by default. */
+		void set_adaptive_spinning(bool enabled) { m_adaptive_spinning_enabled.store(enabled, std::memory_order_relaxed); }
+		bool adaptive_spinning() const { return m_adaptive_spinning_enabled.load(std::memory_order_relaxed); }
+
+		class adaptive_spin_stats_type {
+		public:
+			/* lock acquisitions that had to wait, but succeeded while spinning */
+			unsigned long long m_num_spin_acquisitions = 0;
+			/* lock acquisitions that exhausted the spin budget and blocked */
+			unsigned long long m_num_park_acquisitions = 0;
+			std::chrono::nanoseconds m_current_spin_budget = std::chrono::nanoseconds(0);
+		};
+		adaptive_spin_stats_type adaptive_spin_stats() const {
+			adaptive_spin_stats_type retval;
+			retval.m_num_spin_acquisitions = m_num_spin_acquisitions.load(std::memory_order_relaxed);
+			retval.m_num_park_acquisitions = m_num_park_acquisitions.load(std::memory_order_relaxed);
+			retval.m_current_spin_budget = std::chrono::nanoseconds(m_spin_budget_ns.load(std::memory_order_relaxed));
+			return retval;
+		}
 
 		void lock()
 		{	// lock exclusive
 			std::lock_guard<std::mutex> lock1(m_write_mutex);
 
 			if ((1 <= m_writelock_count) && (std::this_thread::get_id() == m_writelock_thread_id)) {
+				metrics_on_recursive_reentry();
 			}
 			else {
 				assert((std::this_thread::get_id() != m_writelock_thread_id) || (0 == m_writelock_count));
+				const auto wait_start_time = metrics_now();
 				{
 					unlock_guard<std::mutex> unlock1(m_write_mutex);
-					base_class::lock();
+					base_lock();
 				}
 				m_writelock_thread_id = std::this_thread::get_id();
 				assert(0 == m_writelock_count);
+				metrics_on_exclusive_acquired(wait_start_time);
 			}
 			m_writelock_count += 1;
 		}
@@ -80,13 +928,19 @@ namespace mse {
 			if ((1 <= m_writelock_count) && (std::this_thread::get_id() == m_writelock_thread_id)) {
 				m_writelock_count += 1;
 				retval = true;
+				metrics_on_recursive_reentry();
 			}
 			else {
-				assert(0 == m_writelock_count);
+				assert((std::this_thread::get_id() != m_writelock_thread_id) || (0 == m_writelock_count));
+				const auto wait_start_time = metrics_now();
 				retval = base_class::try_lock();
 				if (retval) {
 					m_writelock_thread_id = std::this_thread::get_id();
 					m_writelock_count += 1;
+					metrics_on_exclusive_acquired(wait_start_time);
+				}
+				else {
+					metrics_on_try_lock_failure();
 				}
 			}
 			return retval;
@@ -107,13 +961,24 @@ namespace mse {
 			if ((1 <= m_writelock_count) && (std::this_thread::get_id() == m_writelock_thread_id)) {
 				m_writelock_count += 1;
 				retval = true;
+				metrics_on_recursive_reentry();
 			}
 			else {
-				assert(0 == m_writelock_count);
-				retval = base_class::try_lock_until(_Abs_time);
+				assert((std::this_thread::get_id() != m_writelock_thread_id) || (0 == m_writelock_count));
+				const auto wait_start_time = metrics_now();
+				{
+					/* We don't want to block other threads' (un)lock bookkeeping while we wait. */
+					unlock_guard<std::mutex> unlock1(m_write_mutex);
+					retval = base_class::try_lock_until(_Abs_time);
+				}
 				if (retval) {
 					m_writelock_thread_id = std::this_thread::get_id();
+					assert(0 == m_writelock_count);
 					m_writelock_count += 1;
+					metrics_on_exclusive_acquired(wait_start_time);
+				}
+				else {
+					metrics_on_try_lock_failure();
 				}
 			}
 			return retval;
@@ -128,6 +993,7 @@ namespace mse {
 			}
 			else {
 				assert(1 == m_writelock_count);
+				metrics_on_exclusive_released();
 				base_class::unlock();
 			}
 			m_writelock_count -= 1;
@@ -141,12 +1007,14 @@ namespace mse {
 			const auto found_it = m_thread_id_readlock_count_map.find(this_thread_id);
 			if ((m_thread_id_readlock_count_map.end() != found_it) && (1 <= (*found_it).second)) {
 				(*found_it).second += 1;
+				metrics_on_recursive_reentry();
 			}
 			else {
 				assert((m_thread_id_readlock_count_map.end() == found_it) || (0 == (*found_it).second));
+				const auto wait_start_time = metrics_now();
 				{
 					unlock_guard<std::mutex> unlock1(m_read_mutex);
-					base_class::lock_shared();
+					base_lock_shared();
 				}
 				try {
 					/* Things could've changed so we have to check again. */
@@ -162,8 +1030,9 @@ namespace mse {
 				}
 				catch (...) {
 					base_class::unlock_shared();
-					throw(rstm_bad_alloc("std::unordered_map<>::insert() failed? - mse::recursive_shared_timed_mutex"));
+					throw(rstm_bad_alloc("std::unordered_map<>::insert() failed? - mse::basic_recursive_shared_timed_mutex"));
 				}
+				metrics_on_shared_acquired(wait_start_time);
 			}
 		}
 
@@ -177,9 +1046,14 @@ namespace mse {
 			if ((m_thread_id_readlock_count_map.end() != found_it) && (1 <= (*found_it).second)) {
 				(*found_it).second += 1;
 				retval = true;
+				metrics_on_recursive_reentry();
 			}
 			else {
+				const auto wait_start_time = metrics_now();
 				retval = base_class::try_lock_shared();
+				if (!retval) {
+					metrics_on_try_lock_failure();
+				}
 				if (retval) {
 					try {
 						if (m_thread_id_readlock_count_map.end() != found_it) {
@@ -193,8 +1067,9 @@ namespace mse {
 					}
 					catch (...) {
 						base_class::unlock_shared();
-						throw(rstm_bad_alloc("std::unordered_map<>::insert() failed? - mse::recursive_shared_timed_mutex"));
+						throw(rstm_bad_alloc("std::unordered_map<>::insert() failed? - mse::basic_recursive_shared_timed_mutex"));
 					}
+					metrics_on_shared_acquired(wait_start_time);
 				}
 			}
 			return retval;
@@ -217,14 +1092,25 @@ namespace mse {
 			if ((m_thread_id_readlock_count_map.end() != found_it) && (1 <= (*found_it).second)) {
 				(*found_it).second += 1;
 				retval = true;
+				metrics_on_recursive_reentry();
 			}
 			else {
-				retval = base_class::try_lock_shared_until(_Abs_time);
+				const auto wait_start_time = metrics_now();
+				{
+					/* We don't want to block other threads' (un)lock bookkeeping while we wait. */
+					unlock_guard<std::mutex> unlock1(m_read_mutex);
+					retval = base_class::try_lock_shared_until(_Abs_time);
+				}
+				if (!retval) {
+					metrics_on_try_lock_failure();
+				}
 				if (retval) {
 					try {
-						if (m_thread_id_readlock_count_map.end() != found_it) {
-							assert(0 <= (*found_it).second);
-							(*found_it).second += 1;
+						/* Things could've changed so we have to check again. */
+						const auto l_found_it = m_thread_id_readlock_count_map.find(this_thread_id);
+						if (m_thread_id_readlock_count_map.end() != l_found_it) {
+							assert(0 <= (*l_found_it).second);
+							(*l_found_it).second += 1;
 						}
 						else {
 							std::unordered_map<std::thread::id, int>::value_type item(this_thread_id, 1);
@@ -233,8 +1119,9 @@ namespace mse {
 					}
 					catch (...) {
 						base_class::unlock_shared();
-						throw(rstm_bad_alloc("std::unordered_map<>::insert() failed? - mse::recursive_shared_timed_mutex"));
+						throw(rstm_bad_alloc("std::unordered_map<>::insert() failed? - mse::basic_recursive_shared_timed_mutex"));
 					}
+					metrics_on_shared_acquired(wait_start_time);
 				}
 			}
 			return retval;
@@ -253,6 +1140,7 @@ namespace mse {
 				else {
 					assert(1 == (*found_it).second);
 					m_thread_id_readlock_count_map.erase(found_it);
+					metrics_on_shared_released();
 					base_class::unlock_shared();
 				}
 			}
@@ -268,28 +1156,1257 @@ namespace mse {
 		std::thread::id m_writelock_thread_id;
 		int m_writelock_count = 0;
 		std::unordered_map<std::thread::id, int> m_thread_id_readlock_count_map;
-	};
 
-	//typedef std::shared_timed_mutex async_shared_timed_mutex_type;
-	typedef recursive_shared_timed_mutex async_shared_timed_mutex_type;
+	private:
+#ifdef MSE_ASYNCSHARED_LOCK_METRICS
+		static std::chrono::steady_clock::time_point metrics_now() { return std::chrono::steady_clock::now(); }
+		void metrics_on_recursive_reentry() { m_metrics.on_recursive_reentry(); }
+		void metrics_on_try_lock_failure() { m_metrics.on_try_lock_failure(); }
+		void metrics_on_exclusive_acquired(std::chrono::steady_clock::time_point wait_start_time) { m_metrics.on_exclusive_acquired(wait_start_time); }
+		void metrics_on_exclusive_released() { m_metrics.on_exclusive_released(); }
+		void metrics_on_shared_acquired(std::chrono::steady_clock::time_point wait_start_time) { m_metrics.on_shared_acquired(wait_start_time); }
+		void metrics_on_shared_released() { m_metrics.on_shared_released(); }
+#else // MSE_ASYNCSHARED_LOCK_METRICS
+		static std::chrono::steady_clock::time_point metrics_now() { return std::chrono::steady_clock::time_point(); }
+		void metrics_on_recursive_reentry() {}
+		void metrics_on_try_lock_failure() {}
+		void metrics_on_exclusive_acquired(std::chrono::steady_clock::time_point) {}
+		void metrics_on_exclusive_released() {}
+		void metrics_on_shared_acquired(std::chrono::steady_clock::time_point) {}
+		void metrics_on_shared_released() {}
+#endif // MSE_ASYNCSHARED_LOCK_METRICS
 
-	template<typename _Ty> class TAsyncSharedReadWriteAccessRequester;
-	template<typename _Ty> class TAsyncSharedReadWritePointer;
-	template<typename _Ty> class TAsyncSharedReadWriteConstPointer;
-	template<typename _Ty> class TAsyncSharedReadOnlyAccessRequester;
-	template<typename _Ty> class TAsyncSharedReadOnlyConstPointer;
+		void base_lock() {
+			if (m_adaptive_spinning_enabled.load(std::memory_order_relaxed)) {
+				if (base_class::try_lock() || adaptive_spin([this]() { return base_class::try_lock(); })) {
+					return;
+				}
+				m_num_park_acquisitions.fetch_add(1, std::memory_order_relaxed);
+			}
+			base_class::lock();
+		}
+		void base_lock_shared() {
+			if (m_adaptive_spinning_enabled.load(std::memory_order_relaxed)) {
+				if (base_class::try_lock_shared() || adaptive_spin([this]() { return base_class::try_lock_shared(); })) {
+					return;
+				}
+				m_num_park_acquisitions.fetch_add(1, std::memory_order_relaxed);
+			}
+			base_class::lock_shared();
+		}
 
-	template<typename _Ty> class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester;
-	template<typename _Ty> class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer;
-	template<typename _Ty> class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer;
-	template<typename _Ty> class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester;
-	template<typename _Ty> class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer;
+		template<class _TTryAcquire>
+		bool adaptive_spin(const _TTryAcquire& try_acquire) {
+			typedef std::chrono::steady_clock clock_type;
+			/* Since the budget is only learned from spins that succeed, once it has shrunk (because hold times were long)
+			spins with it would rarely succeed even if hold times got short again. So every so often we spin with the
+			maximum budget instead. */
+			const bool is_probe = (0 == (m_num_spins.fetch_add(1, std::memory_order_relaxed) % sc_probe_interval));
+			const auto spin_budget = std::chrono::nanoseconds(is_probe ? sc_max_spin_budget_ns : m_spin_budget_ns.load(std::memory_order_relaxed));
+			const auto t1 = clock_type::now();
+			size_t num_pauses = 1;
+			while (true) {
+				for (size_t i = 0; i < num_pauses; i += 1) {
+					impl::cpu_relax();
+				}
+				if (num_pauses < sc_max_pauses_per_spin) {
+					num_pauses *= 2;
+				}
+				else {
+					/* (Once the backoff has maxed out, we also give the holder a chance to run, in case it's waiting for
+					our cpu.) */
+					std::this_thread::yield();
+				}
+				if (try_acquire()) {
+					const auto wait_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - t1).count();
+					/* Aim for a budget of about twice the observed wait, moving an eighth of the way there each time. (A
+					successful probe indicates that the budget is stale, so it goes all the way.) */
+					update_spin_budget(2 * wait_ns, is_probe ? 1 : 8);
+					m_num_spin_acquisitions.fetch_add(1, std::memory_order_relaxed);
+					return true;
+				}
+				if ((clock_type::now() - t1) >= spin_budget) {
+					break;
+				}
+			}
+			/* The wait was longer than the budget. Back off the budget a bit so that objects with long hold times
+			converge towards parking right away. */
+			update_spin_budget(0, 4);
+			return false;
+		}
+		void update_spin_budget(long long target_ns, long long inverse_rate) {
+			auto budget_ns = m_spin_budget_ns.load(std::memory_order_relaxed);
+			auto new_budget_ns = budget_ns + (target_ns - budget_ns) / inverse_rate;
+			if (sc_min_spin_budget_ns > new_budget_ns) { new_budget_ns = sc_min_spin_budget_ns; }
+			if (sc_max_spin_budget_ns < new_budget_ns) { new_budget_ns = sc_max_spin_budget_ns; }
+			/* Concurrent updates may overwrite each other, which is fine for a heuristic. */
+			m_spin_budget_ns.store(new_budget_ns, std::memory_order_relaxed);
+		}
+
+		static const size_t sc_max_pauses_per_spin = 64;
+		static const long long sc_min_spin_budget_ns = 200;
+		static const long long sc_max_spin_budget_ns = 50000;
+		/* (one in every sc_probe_interval spins uses the maximum budget) */
+		static const unsigned long long sc_probe_interval = 64;
+
+		std::atomic<bool> m_adaptive_spinning_enabled{ false };
+		std::atomic<long long> m_spin_budget_ns{ 2000 };
+		std::atomic<unsigned long long> m_num_spins{ 0 };
+		std::atomic<unsigned long long> m_num_spin_acquisitions{ 0 };
+		std::atomic<unsigned long long> m_num_park_acquisitions{ 0 };
+#ifdef MSE_ASYNCSHARED_LOCK_METRICS
+		impl::CLockMetrics m_metrics{ this };
+#endif // MSE_ASYNCSHARED_LOCK_METRICS
+	};
+
+	typedef basic_recursive_shared_timed_mutex<> recursive_shared_timed_mutex;
+	/* A recursive_shared_timed_mutex that honors lock request priorities (see rw_fairness::priority_classes). To have a type
+	of shared object use it:
+	namespace mse { template<> struct async_shared_timed_mutex_type_for<CTileCache> { typedef priority_recursive_shared_timed_mutex type; }; } */
+	typedef basic_recursive_shared_timed_mutex<rw_fairness::priority_classes> priority_recursive_shared_timed_mutex;
+
+	/* thread_local_recursive_shared_timed_mutex has the same (recursive) semantics as recursive_shared_timed_mutex, but
+	rather than keeping a shared (mutex protected) map of the read lock counts of each thread, each thread keeps track of
+	its own read lock counts in thread local storage. And the write lock owner is tracked with an atomic thread id rather
+	than under a mutex. So recursive (and uncontended) lock acquisitions don't touch any shared bookkeeping mutex, and (in
+	the common case) don't allocate. */
+	class thread_local_recursive_shared_timed_mutex : private std::shared_timed_mutex {
+	public:
+		typedef std::shared_timed_mutex base_class;
+
+		void lock()
+		{	// lock exclusive
+			const auto this_thread_id = std::this_thread::get_id();
+			if (this_thread_id == m_writelock_thread_id.load(std::memory_order_relaxed)) {
+				/* m_writelock_count is only ever accessed by the thread that owns the write lock. */
+				m_writelock_count += 1;
+			}
+			else {
+				base_class::lock();
+				m_writelock_thread_id.store(this_thread_id, std::memory_order_relaxed);
+				assert(0 == m_writelock_count);
+				m_writelock_count = 1;
+			}
+		}
+
+		bool try_lock()
+		{	// try to lock exclusive
+			const auto this_thread_id = std::this_thread::get_id();
+			if (this_thread_id == m_writelock_thread_id.load(std::memory_order_relaxed)) {
+				m_writelock_count += 1;
+				return true;
+			}
+			if (!base_class::try_lock()) {
+				return false;
+			}
+			m_writelock_thread_id.store(this_thread_id, std::memory_order_relaxed);
+			assert(0 == m_writelock_count);
+			m_writelock_count = 1;
+			return true;
+		}
+
+		template<class _Rep, class _Period>
+		bool try_lock_for(const std::chrono::duration<_Rep, _Period>& _Rel_time)
+		{	// try to lock for duration
+			return (try_lock_until(std::chrono::steady_clock::now() + _Rel_time));
+		}
+
+		template<class _Clock, class _Duration>
+		bool try_lock_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time)
+		{	// try to lock until time point
+			const auto this_thread_id = std::this_thread::get_id();
+			if (this_thread_id == m_writelock_thread_id.load(std::memory_order_relaxed)) {
+				m_writelock_count += 1;
+				return true;
+			}
+			if (!base_class::try_lock_until(_Abs_time)) {
+				return false;
+			}
+			m_writelock_thread_id.store(this_thread_id, std::memory_order_relaxed);
+			assert(0 == m_writelock_count);
+			m_writelock_count = 1;
+			return true;
+		}
+
+		void unlock()
+		{	// unlock exclusive
+			assert(std::this_thread::get_id() == m_writelock_thread_id.load(std::memory_order_relaxed));
+			if (2 <= m_writelock_count) {
+				m_writelock_count -= 1;
+			}
+			else {
+				assert(1 == m_writelock_count);
+				m_writelock_count = 0;
+				m_writelock_thread_id.store(std::thread::id(), std::memory_order_relaxed);
+				base_class::unlock();
+			}
+		}
+
+		void lock_shared()
+		{	// lock non-exclusive
+			auto& entry_ref = impl::tl_lock_counts().find_or_insert(this);
+			if (1 <= entry_ref.m_readlock_count) {
+				entry_ref.m_readlock_count += 1;
+				return;
+			}
+			try {
+				base_class::lock_shared();
+			}
+			catch (...) {
+				impl::tl_lock_counts().erase(this);
+				throw;
+			}
+			entry_ref.m_readlock_count = 1;
+		}
+
+		bool try_lock_shared()
+		{	// try to lock non-exclusive
+			auto& entry_ref = impl::tl_lock_counts().find_or_insert(this);
+			if (1 <= entry_ref.m_readlock_count) {
+				entry_ref.m_readlock_count += 1;
+				return true;
+			}
+			if (!base_class::try_lock_shared()) {
+				impl::tl_lock_counts().erase(this);
+				return false;
+			}
+			entry_ref.m_readlock_count = 1;
+			return true;
+		}
+
+		template<class _Rep, class _Period>
+		bool try_lock_shared_for(const std::chrono::duration<_Rep, _Period>& _Rel_time)
+		{	// try to lock non-exclusive for relative time
+			return (try_lock_shared_until(_Rel_time + std::chrono::steady_clock::now()));
+		}
+
+		template<class _Clock, class _Duration>
+		bool try_lock_shared_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time)
+		{	// try to lock non-exclusive until absolute time
+			auto& entry_ref = impl::tl_lock_counts().find_or_insert(this);
+			if (1 <= entry_ref.m_readlock_count) {
+				entry_ref.m_readlock_count += 1;
+				return true;
+			}
+			bool retval = false;
+			try {
+				retval = base_class::try_lock_shared_until(_Abs_time);
+			}
+			catch (...) {
+				impl::tl_lock_counts().erase(this);
+				throw;
+			}
+			if (!retval) {
+				impl::tl_lock_counts().erase(this);
+				return false;
+			}
+			entry_ref.m_readlock_count = 1;
+			return true;
+		}
+
+		void unlock_shared()
+		{	// unlock non-exclusive
+			auto entry_ptr = impl::tl_lock_counts().find(this);
+			assert(entry_ptr && (1 <= entry_ptr->m_readlock_count));
+			if (entry_ptr && (2 <= entry_ptr->m_readlock_count)) {
+				entry_ptr->m_readlock_count -= 1;
+			}
+			else {
+				impl::tl_lock_counts().erase(this);
+				base_class::unlock_shared();
+			}
+		}
+
+	private:
+		std::atomic<std::thread::id> m_writelock_thread_id{ std::thread::id() };
+		int m_writelock_count = 0;
+	};
+
+	/* sharded_recursive_shared_timed_mutex is a "reader biased" recursive shared mutex intended for objects that are
+	(almost) only ever read. Rather than every reader incrementing the same (cache line bouncing) counter, each reader
+	registers itself in one of _NumReaderSlots counters, each in its own cache line, chosen by the cpu the reader is
+	running on. Writers (which are serialized by their own mutex) raise a flag and wait for all the reader slots to
+	drain (spinning briefly, then blocking until the last reader leaves). So read locks scale with the number of reader
+	cores, at the cost of more expensive write locks and a larger mutex (about _NumReaderSlots cache lines). Read lock
+	recursion is tracked in thread local storage. Requesting a write lock while holding a read lock would deadlock, and
+	so throws instead. */
+	template<size_t _NumReaderSlots = 32>
+	class sharded_recursive_shared_timed_mutex {
+	public:
+		static_assert(1 <= _NumReaderSlots, "sharded_recursive_shared_timed_mutex<> requires at least one reader slot");
+
+		sharded_recursive_shared_timed_mutex() {}
+		sharded_recursive_shared_timed_mutex(const sharded_recursive_shared_timed_mutex&) = delete;
+		sharded_recursive_shared_timed_mutex& operator=(const sharded_recursive_shared_timed_mutex&) = delete;
+
+		void lock()
+		{	// lock exclusive
+			const auto this_thread_id = std::this_thread::get_id();
+			if (this_thread_id == m_writelock_thread_id.load(std::memory_order_relaxed)) {
+				m_writelock_count += 1;
+				return;
+			}
+			throw_if_read_lock_held();
+			m_writer_mutex.lock();
+			m_writer_active.store(true, std::memory_order_seq_cst);
+			wait_for_readers_to_drain();
+			set_write_owner(this_thread_id);
+		}
+
+		bool try_lock()
+		{	// try to lock exclusive
+			const auto this_thread_id = std::this_thread::get_id();
+			if (this_thread_id == m_writelock_thread_id.load(std::memory_order_relaxed)) {
+				m_writelock_count += 1;
+				return true;
+			}
+			throw_if_read_lock_held();
+			if (!m_writer_mutex.try_lock()) {
+				return false;
+			}
+			m_writer_active.store(true, std::memory_order_seq_cst);
+			if (!readers_are_drained()) {
+				m_writer_active.store(false, std::memory_order_seq_cst);
+				m_writer_mutex.unlock();
+				return false;
+			}
+			set_write_owner(this_thread_id);
+			return true;
+		}
+
+		template<class _Rep, class _Period>
+		bool try_lock_for(const std::chrono::duration<_Rep, _Period>& _Rel_time)
+		{	// try to lock for duration
+			return (try_lock_until(std::chrono::steady_clock::now() + _Rel_time));
+		}
+
+		template<class _Clock, class _Duration>
+		bool try_lock_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time)
+		{	// try to lock until time point
+			const auto this_thread_id = std::this_thread::get_id();
+			if (this_thread_id == m_writelock_thread_id.load(std::memory_order_relaxed)) {
+				m_writelock_count += 1;
+				return true;
+			}
+			throw_if_read_lock_held();
+			if (!m_writer_mutex.try_lock_until(_Abs_time)) {
+				return false;
+			}
+			m_writer_active.store(true, std::memory_order_seq_cst);
+			if (!wait_for_readers_to_drain(&_Abs_time)) {
+				m_writer_active.store(false, std::memory_order_seq_cst);
+				m_writer_mutex.unlock();
+				return false;
+			}
+			set_write_owner(this_thread_id);
+			return true;
+		}
+
+		void unlock()
+		{	// unlock exclusive
+			assert(std::this_thread::get_id() == m_writelock_thread_id.load(std::memory_order_relaxed));
+			if (2 <= m_writelock_count) {
+				m_writelock_count -= 1;
+			}
+			else {
+				assert(1 == m_writelock_count);
+				m_writelock_count = 0;
+				m_writelock_thread_id.store(std::thread::id(), std::memory_order_relaxed);
+				m_writer_active.store(false, std::memory_order_seq_cst);
+				m_writer_mutex.unlock();
+			}
+		}
+
+		void lock_shared()
+		{	// lock non-exclusive
+			auto& entry_ref = impl::tl_lock_counts().find_or_insert(this);
+			if (1 <= entry_ref.m_readlock_count) {
+				entry_ref.m_readlock_count += 1;
+				return;
+			}
+			if (std::this_thread::get_id() == m_writelock_thread_id.load(std::memory_order_relaxed)) {
+				/* This thread already holds the write lock, so it doesn't need to wait for the writer flag to be cleared. But
+				it still needs to register as a reader in case it releases the write lock before this read lock. */
+				register_reader_unconditionally(entry_ref);
+				return;
+			}
+			while (true) {
+				if (try_register_reader(entry_ref)) {
+					return;
+				}
+				/* A writer is active, so we'll wait (blocked) for it to release the writer mutex. */
+				std::lock_guard<std::timed_mutex> lock1(m_writer_mutex);
+			}
+		}
+
+		bool try_lock_shared()
+		{	// try to lock non-exclusive
+			auto& entry_ref = impl::tl_lock_counts().find_or_insert(this);
+			if (1 <= entry_ref.m_readlock_count) {
+				entry_ref.m_readlock_count += 1;
+				return true;
+			}
+			if (std::this_thread::get_id() == m_writelock_thread_id.load(std::memory_order_relaxed)) {
+				register_reader_unconditionally(entry_ref);
+				return true;
+			}
+			if (try_register_reader(entry_ref)) {
+				return true;
+			}
+			impl::tl_lock_counts().erase(this);
+			return false;
+		}
+
+		template<class _Rep, class _Period>
+		bool try_lock_shared_for(const std::chrono::duration<_Rep, _Period>& _Rel_time)
+		{	// try to lock non-exclusive for relative time
+			return (try_lock_shared_until(_Rel_time + std::chrono::steady_clock::now()));
+		}
+
+		template<class _Clock, class _Duration>
+		bool try_lock_shared_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time)
+		{	// try to lock non-exclusive until absolute time
+			auto& entry_ref = impl::tl_lock_counts().find_or_insert(this);
+			if (1 <= entry_ref.m_readlock_count) {
+				entry_ref.m_readlock_count += 1;
+				return true;
+			}
+			if (std::this_thread::get_id() == m_writelock_thread_id.load(std::memory_order_relaxed)) {
+				register_reader_unconditionally(entry_ref);
+				return true;
+			}
+			while (true) {
+				if (try_register_reader(entry_ref)) {
+					return true;
+				}
+				if (!m_writer_mutex.try_lock_until(_Abs_time)) {
+					impl::tl_lock_counts().erase(this);
+					return false;
+				}
+				m_writer_mutex.unlock();
+			}
+		}
+
+		void unlock_shared()
+		{	// unlock non-exclusive
+			auto entry_ptr = impl::tl_lock_counts().find(this);
+			assert(entry_ptr && (1 <= entry_ptr->m_readlock_count));
+			if (!entry_ptr) {
+				return;
+			}
+			if (2 <= entry_ptr->m_readlock_count) {
+				entry_ptr->m_readlock_count -= 1;
+			}
+			else {
+				const auto reader_slot_index = entry_ptr->m_reader_slot_index;
+				impl::tl_lock_counts().erase(this);
+				unregister_reader(reader_slot_index);
+			}
+		}
+
+	private:
+		static size_t current_reader_slot_index() {
+#ifdef __linux__
+			const int cpu = sched_getcpu();
+			if (0 <= cpu) {
+				return size_t(cpu) % _NumReaderSlots;
+			}
+#endif // __linux__
+			thread_local const size_t tl_hashed_index = std::hash<std::thread::id>()(std::this_thread::get_id());
+			return tl_hashed_index % _NumReaderSlots;
+		}
+
+		bool try_register_reader(impl::CThreadLocalLockCounts::CEntry& entry_ref) {
+			const auto reader_slot_index = current_reader_slot_index();
+			auto& slot_count_ref = m_reader_slots[reader_slot_index].m_count;
+			/* The (sequentially consistent) increment of our slot must be ordered before our check of the writer flag,
+			just as the writer's setting of the flag is ordered before its check of the slots. */
+			slot_count_ref.fetch_add(1, std::memory_order_seq_cst);
+			if (!m_writer_active.load(std::memory_order_seq_cst)) {
+				entry_ref.m_reader_slot_index = reader_slot_index;
+				entry_ref.m_readlock_count = 1;
+				return true;
+			}
+			unregister_reader(reader_slot_index);
+			return false;
+		}
+
+		void register_reader_unconditionally(impl::CThreadLocalLockCounts::CEntry& entry_ref) {
+			const auto reader_slot_index = current_reader_slot_index();
+			m_reader_slots[reader_slot_index].m_count.fetch_add(1, std::memory_order_seq_cst);
+			entry_ref.m_reader_slot_index = reader_slot_index;
+			entry_ref.m_readlock_count = 1;
+		}
+
+		void unregister_reader(size_t reader_slot_index) {
+			/* The (sequentially consistent) decrement of our slot must be ordered before our check of the "writer is
+			parked" flag, just as the writer's setting of the flag is ordered before its (final) check of the slots. */
+			if ((1 == m_reader_slots[reader_slot_index].m_count.fetch_sub(1, std::memory_order_seq_cst))
+				&& m_writer_is_parked.load(std::memory_order_seq_cst)) {
+				{
+					/* (Acquiring the mutex ensures the writer is either waiting on the condition variable or has yet to
+					check the slots.) */
+					std::lock_guard<std::mutex> lock1(m_drain_mutex);
+				}
+				m_drain_cv.notify_one();
+			}
+		}
+
+		void throw_if_read_lock_held() const {
+			auto entry_ptr = impl::tl_lock_counts().find(this);
+			if (entry_ptr && (1 <= entry_ptr->m_readlock_count)) {
+				/* Our own read lock would prevent the readers from ever draining. */
+				throw(std::system_error(std::make_error_code(std::errc::resource_deadlock_would_occur)
+					, "write lock requested by a thread holding a read lock - mse::sharded_recursive_shared_timed_mutex"));
+			}
+		}
+
+		bool readers_are_drained() const {
+			for (const auto& slot_cref : m_reader_slots) {
+				if (0 != slot_cref.m_count.load(std::memory_order_seq_cst)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		template<class _TTimePoint = std::chrono::steady_clock::time_point>
+		bool wait_for_readers_to_drain(const _TTimePoint* abs_time_ptr = nullptr) {
+			for (const auto& slot_cref : m_reader_slots) {
+				size_t num_spins = 0;
+				while (0 != slot_cref.m_count.load(std::memory_order_seq_cst)) {
+					if (64 > num_spins) {
+						impl::cpu_relax();
+						num_spins += 1;
+					}
+					else {
+						return park_until_readers_are_drained(abs_time_ptr);
+					}
+				}
+			}
+			return true;
+		}
+
+		/* Blocks until the last reader leaves (or the given time is reached). Readers that empty a slot while the flag
+		is set wake us up. */
+		template<class _TTimePoint>
+		bool park_until_readers_are_drained(const _TTimePoint* abs_time_ptr) {
+			std::unique_lock<std::mutex> lock1(m_drain_mutex);
+			m_writer_is_parked.store(true, std::memory_order_seq_cst);
+			bool retval = true;
+			if (abs_time_ptr) {
+				retval = m_drain_cv.wait_until(lock1, *abs_time_ptr, [this]() { return readers_are_drained(); });
+			}
+			else {
+				m_drain_cv.wait(lock1, [this]() { return readers_are_drained(); });
+			}
+			m_writer_is_parked.store(false, std::memory_order_relaxed);
+			return retval;
+		}
+
+		void set_write_owner(std::thread::id this_thread_id) {
+			m_writelock_thread_id.store(this_thread_id, std::memory_order_relaxed);
+			assert(0 == m_writelock_count);
+			m_writelock_count = 1;
+		}
+
+		class alignas(impl::sc_cache_line_size) CReaderSlot {
+		public:
+			std::atomic<int> m_count{ 0 };
+		};
+		CReaderSlot m_reader_slots[_NumReaderSlots];
+
+		alignas(impl::sc_cache_line_size) std::atomic<bool> m_writer_active{ false };
+		/* (only set while the (single) active writer is blocked waiting for the readers to drain) */
+		std::atomic<bool> m_writer_is_parked{ false };
+		std::timed_mutex m_writer_mutex;
+		std::mutex m_drain_mutex;
+		std::condition_variable m_drain_cv;
+		std::atomic<std::thread::id> m_writelock_thread_id{ std::thread::id() };
+		int m_writelock_count = 0;
+	};
+
+#ifdef __linux__
+	/* futex_recursive_shared_timed_mutex is a (Linux only) recursive shared mutex whose entire shared state is a single
+	32 bit atomic word. Blocked threads wait on the word with the futex system call. A thread's recursive lock counts
+	are kept in (thread local) impl::tl_lock_counts(), so (uncontended) lock and unlock operations each cost one atomic
+	read-modify-write on the word. Waiting writers take precedence over new (non-recursive) readers. Requesting a read
+	lock while holding the write lock (or vice versa) would deadlock, and so throws instead. */
+	class futex_recursive_shared_timed_mutex {
+	public:
+		futex_recursive_shared_timed_mutex() {}
+		futex_recursive_shared_timed_mutex(const futex_recursive_shared_timed_mutex&) = delete;
+		futex_recursive_shared_timed_mutex& operator=(const futex_recursive_shared_timed_mutex&) = delete;
+
+		void lock()
+		{	// lock exclusive
+			auto& entry_ref = lock_counts_entry_for_write();
+			if (1 <= entry_ref.m_writelock_count) {
+				entry_ref.m_writelock_count += 1;
+				return;
+			}
+			while (!try_acquire_write()) {
+				wait_while_unavailable(sc_writer_bit | sc_reader_count_mask, sc_writers_waiting_bit, nullptr);
+			}
+			entry_ref.m_writelock_count = 1;
+		}
+
+		bool try_lock()
+		{	// try to lock exclusive
+			auto& entry_ref = lock_counts_entry_for_write();
+			if (1 <= entry_ref.m_writelock_count) {
+				entry_ref.m_writelock_count += 1;
+				return true;
+			}
+			if (!try_acquire_write()) {
+				impl::tl_lock_counts().erase(this);
+				return false;
+			}
+			entry_ref.m_writelock_count = 1;
+			return true;
+		}
+
+		template<class _Rep, class _Period>
+		bool try_lock_for(const std::chrono::duration<_Rep, _Period>& _Rel_time)
+		{	// try to lock for duration
+			return (try_lock_until(std::chrono::steady_clock::now() + _Rel_time));
+		}
+
+		template<class _Clock, class _Duration>
+		bool try_lock_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time)
+		{	// try to lock until time point
+			auto& entry_ref = lock_counts_entry_for_write();
+			if (1 <= entry_ref.m_writelock_count) {
+				entry_ref.m_writelock_count += 1;
+				return true;
+			}
+			while (!try_acquire_write()) {
+				if (!wait_while_unavailable_until(sc_writer_bit | sc_reader_count_mask, sc_writers_waiting_bit, _Abs_time)) {
+					impl::tl_lock_counts().erase(this);
+					return false;
+				}
+			}
+			entry_ref.m_writelock_count = 1;
+			return true;
+		}
+
+		void unlock()
+		{	// unlock exclusive
+			auto entry_ptr = impl::tl_lock_counts().find(this);
+			assert(entry_ptr && (1 <= entry_ptr->m_writelock_count));
+			if (entry_ptr && (2 <= entry_ptr->m_writelock_count)) {
+				entry_ptr->m_writelock_count -= 1;
+				return;
+			}
+			impl::tl_lock_counts().erase(this);
+			const auto prev_state = m_state.fetch_and(~(sc_writer_bit | sc_waiting_bits), std::memory_order_release);
+			if (prev_state & sc_waiting_bits) {
+				wake_all();
+			}
+		}
+
+		void lock_shared()
+		{	// lock non-exclusive
+			auto& entry_ref = lock_counts_entry_for_read();
+			if (1 <= entry_ref.m_readlock_count) {
+				entry_ref.m_readlock_count += 1;
+				return;
+			}
+			while (!try_acquire_read()) {
+				wait_while_unavailable(sc_writer_bit | sc_writers_waiting_bit, sc_readers_waiting_bit, nullptr);
+			}
+			entry_ref.m_readlock_count = 1;
+		}
+
+		bool try_lock_shared()
+		{	// try to lock non-exclusive
+			auto& entry_ref = lock_counts_entry_for_read();
+			if (1 <= entry_ref.m_readlock_count) {
+				entry_ref.m_readlock_count += 1;
+				return true;
+			}
+			if (!try_acquire_read()) {
+				impl::tl_lock_counts().erase(this);
+				return false;
+			}
+			entry_ref.m_readlock_count = 1;
+			return true;
+		}
+
+		template<class _Rep, class _Period>
+		bool try_lock_shared_for(const std::chrono::duration<_Rep, _Period>& _Rel_time)
+		{	// try to lock non-exclusive for relative time
+			return (try_lock_shared_until(_Rel_time + std::chrono::steady_clock::now()));
+		}
+
+		template<class _Clock, class _Duration>
+		bool try_lock_shared_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time)
+		{	// try to lock non-exclusive until absolute time
+			auto& entry_ref = lock_counts_entry_for_read();
+			if (1 <= entry_ref.m_readlock_count) {
+				entry_ref.m_readlock_count += 1;
+				return true;
+			}
+			while (!try_acquire_read()) {
+				if (!wait_while_unavailable_until(sc_writer_bit | sc_writers_waiting_bit, sc_readers_waiting_bit, _Abs_time)) {
+					impl::tl_lock_counts().erase(this);
+					return false;
+				}
+			}
+			entry_ref.m_readlock_count = 1;
+			return true;
+		}
+
+		void unlock_shared()
+		{	// unlock non-exclusive
+			auto entry_ptr = impl::tl_lock_counts().find(this);
+			assert(entry_ptr && (1 <= entry_ptr->m_readlock_count));
+			if (entry_ptr && (2 <= entry_ptr->m_readlock_count)) {
+				entry_ptr->m_readlock_count -= 1;
+				return;
+			}
+			impl::tl_lock_counts().erase(this);
+			auto state = m_state.fetch_sub(1, std::memory_order_release) - 1;
+			/* The last reader out wakes any waiters. */
+			while ((0 == (state & sc_reader_count_mask)) && (state & sc_waiting_bits)) {
+				if (m_state.compare_exchange_weak(state, state & ~sc_waiting_bits, std::memory_order_relaxed)) {
+					wake_all();
+					break;
+				}
+			}
+		}
+
+	private:
+		static const uint32_t sc_writer_bit = uint32_t(1) << 31;
+		static const uint32_t sc_writers_waiting_bit = uint32_t(1) << 30;
+		static const uint32_t sc_readers_waiting_bit = uint32_t(1) << 29;
+		static const uint32_t sc_waiting_bits = sc_writers_waiting_bit | sc_readers_waiting_bit;
+		static const uint32_t sc_reader_count_mask = sc_readers_waiting_bit - 1;
+
+		impl::CThreadLocalLockCounts::CEntry& lock_counts_entry_for_write() {
+			auto& entry_ref = impl::tl_lock_counts().find_or_insert(this);
+			if (1 <= entry_ref.m_readlock_count) {
+				throw(std::system_error(std::make_error_code(std::errc::resource_deadlock_would_occur)
+					, "write lock requested by a thread holding a read lock - mse::futex_recursive_shared_timed_mutex"));
+			}
+			return entry_ref;
+		}
+		impl::CThreadLocalLockCounts::CEntry& lock_counts_entry_for_read() {
+			auto& entry_ref = impl::tl_lock_counts().find_or_insert(this);
+			if (1 <= entry_ref.m_writelock_count) {
+				throw(std::system_error(std::make_error_code(std::errc::resource_deadlock_would_occur)
+					, "read lock requested by the thread holding the write lock - mse::futex_recursive_shared_timed_mutex"));
+			}
+			return entry_ref;
+		}
+
+		bool try_acquire_write() {
+			auto state = m_state.load(std::memory_order_relaxed);
+			while (0 == (state & (sc_writer_bit | sc_reader_count_mask))) {
+				if (m_state.compare_exchange_weak(state, state | sc_writer_bit, std::memory_order_acquire, std::memory_order_relaxed)) {
+					return true;
+				}
+			}
+			return false;
+		}
+		bool try_acquire_read() {
+			auto state = m_state.load(std::memory_order_relaxed);
+			while (0 == (state & (sc_writer_bit | sc_writers_waiting_bit))) {
+				assert(sc_reader_count_mask != (state & sc_reader_count_mask));
+				if (m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/* Sets the given "waiting" bit and waits (until woken, or the timeout expires) as long as any of the
+		"unavailable_bits" are set. Returns false if the timeout expired. */
+		bool wait_while_unavailable(uint32_t unavailable_bits, uint32_t waiting_bit, const struct timespec* rel_timeout_ptr) {
+			auto state = m_state.load(std::memory_order_relaxed);
+			while (state & unavailable_bits) {
+				if ((state & waiting_bit) || m_state.compare_exchange_weak(state, state | waiting_bit, std::memory_order_relaxed)) {
+					const auto res = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_state), FUTEX_WAIT_PRIVATE, state | waiting_bit, rel_timeout_ptr, nullptr, 0);
+					if ((-1 == res) && (ETIMEDOUT == errno)) {
+						return false;
+					}
+					return true;
+				}
+			}
+			return true;
+		}
+		template<class _Clock, class _Duration>
+		bool wait_while_unavailable_until(uint32_t unavailable_bits, uint32_t waiting_bit, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
+			const auto now = _Clock::now();
+			if (now >= _Abs_time) {
+				return false;
+			}
+			const auto rel_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(_Abs_time - now).count();
+			struct timespec rel_timeout;
+			rel_timeout.tv_sec = time_t(rel_time_ns / 1000000000);
+			rel_timeout.tv_nsec = long(rel_time_ns % 1000000000);
+			/* (A timed out wait may have been a spurious one, so the caller will check the time again.) */
+			wait_while_unavailable(unavailable_bits, waiting_bit, &rel_timeout);
+			return true;
+		}
+		void wake_all() {
+			syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_state), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+		}
+
+		std::atomic<uint32_t> m_state{ 0 };
+	};
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex_recursive_shared_timed_mutex requires a lock-free 32 bit atomic");
+#endif // __linux__
+
+#if defined(MSE_ASYNCSHARED_USE_FUTEX_MUTEX) && defined(__linux__)
+	typedef futex_recursive_shared_timed_mutex async_shared_timed_mutex_type;
+#elif defined(MSE_ASYNCSHARED_USE_THREAD_LOCAL_LOCK_COUNTS)
+	typedef thread_local_recursive_shared_timed_mutex async_shared_timed_mutex_type;
+#else // MSE_ASYNCSHARED_USE_THREAD_LOCAL_LOCK_COUNTS
+	//typedef std::shared_timed_mutex async_shared_timed_mutex_type;
+	typedef recursive_shared_timed_mutex async_shared_timed_mutex_type;
+#endif // MSE_ASYNCSHARED_USE_THREAD_LOCAL_LOCK_COUNTS
+
+	/* By default, shared objects are protected by an async_shared_timed_mutex_type. The mutex used for a particular type
+	of shared object can be selected by specializing this template. For example:
+	namespace mse { template<> struct async_shared_timed_mutex_type_for<CImageWithProtectedCache> { typedef sharded_recursive_shared_timed_mutex<> type; }; } */
+	template<typename _Ty>
+	struct async_shared_timed_mutex_type_for {
+		typedef async_shared_timed_mutex_type type;
+	};
+
+	/* The lock policies of TAsyncSharedAccessRequester<>. */
+	namespace lock_policy {
+		/* Read locks are exclusive (i.e. the same as write locks), so the shared object may have "unprotected" mutable
+		members (like caches) that are modified by const member functions. (The TAsyncSharedReadWrite... and
+		TAsyncSharedReadOnly... types.) */
+		class exclusive_reads {};
+		/* Read locks are shared, so only for objects that you're sure have no unprotected mutable members. Write locks
+		also hold the object's "upgrade gate", which makes upgradeable read locks possible. (The
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutables... types.) */
+		class shared_reads {};
+		/* No locking at all. Obtaining a borrowed lock pointer doesn't execute any instructions, and obtaining an
+		ordinary lock pointer just involves the reference count. Only for single threaded builds, or objects that are
+		otherwise known to be accessed by only one thread at a time. */
+		class no_locking {};
+	}
+	/* The access policies of TAsyncSharedAccessRequester<>. */
+	namespace access_policy {
+		/* write lock pointers and (const) read lock pointers */
+		class read_write {};
+		/* only (const) read lock pointers */
+		class read_only {};
+	}
+
+	template<typename _Ty, class _TLockPolicy = lock_policy::exclusive_reads, class _TAccessPolicy = access_policy::read_write> class TAsyncSharedAccessRequester;
+	template<typename _Ty, class _TLockPolicy, class _TAccessPolicy> class TAsyncSharedAccessPointer;
+
+	/* Note that a requester's read lock pointer type depends only on its lock policy, so the "ReadWriteConstPointer" and
+	"ReadOnlyConstPointer" aliases (of a given lock policy) name the same type. */
+	template<typename _Ty> using TAsyncSharedReadWriteAccessRequester = TAsyncSharedAccessRequester<_Ty, lock_policy::exclusive_reads, access_policy::read_write>;
+	template<typename _Ty> using TAsyncSharedReadWritePointer = TAsyncSharedAccessPointer<_Ty, lock_policy::exclusive_reads, access_policy::read_write>;
+	template<typename _Ty> using TAsyncSharedReadWriteConstPointer = TAsyncSharedAccessPointer<_Ty, lock_policy::exclusive_reads, access_policy::read_only>;
+	template<typename _Ty> using TAsyncSharedReadOnlyAccessRequester = TAsyncSharedAccessRequester<_Ty, lock_policy::exclusive_reads, access_policy::read_only>;
+	template<typename _Ty> using TAsyncSharedReadOnlyConstPointer = TAsyncSharedAccessPointer<_Ty, lock_policy::exclusive_reads, access_policy::read_only>;
+
+	template<typename _Ty> using TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester = TAsyncSharedAccessRequester<_Ty, lock_policy::shared_reads, access_policy::read_write>;
+	template<typename _Ty> using TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer = TAsyncSharedAccessPointer<_Ty, lock_policy::shared_reads, access_policy::read_write>;
+	template<typename _Ty> using TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer = TAsyncSharedAccessPointer<_Ty, lock_policy::shared_reads, access_policy::read_only>;
+	template<typename _Ty> using TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester = TAsyncSharedAccessRequester<_Ty, lock_policy::shared_reads, access_policy::read_only>;
+	template<typename _Ty> using TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer = TAsyncSharedAccessPointer<_Ty, lock_policy::shared_reads, access_policy::read_only>;
+	template<typename _Ty> class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer;
+	template<typename _Ty> class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer;
+	namespace impl {
+		class CAsyncSharedPrivateAccess;
+	}
+
+	namespace impl {
+		/* Lock metrics are only available from mutexes that record them (see MSE_ASYNCSHARED_LOCK_METRICS). */
+		template<class _TMutex>
+		auto lock_metrics_of(const _TMutex& mutex_cref, int) -> decltype(mutex_cref.lock_metrics()) {
+			return mutex_cref.lock_metrics();
+		}
+		template<class _TMutex>
+		lock_metrics_snapshot lock_metrics_of(const _TMutex& mutex_cref, long) {
+			lock_metrics_snapshot retval;
+			retval.m_mutex_ptr = std::addressof(mutex_cref);
+			return retval;
+		}
+		template<class _TMutex>
+		auto set_lock_metrics_label(_TMutex& mutex_ref, const char* label, int) -> decltype(mutex_ref.set_lock_metrics_label(label)) {
+			return mutex_ref.set_lock_metrics_label(label);
+		}
+		template<class _TMutex>
+		void set_lock_metrics_label(_TMutex&, const char*, long) {}
+
+		/* Upgradeable read locks are held by at most one thread at a time. They coexist with ordinary read locks, but not
+		with write locks. Upgrading (or downgrading) involves releasing the lock on the main mutex and reacquiring it in
+		the other mode, and while that's in progress the gate is marked as being "in transition". A writer that obtains the
+		main mutex while the gate is in transition releases it again and waits for the transition to complete. So no writer
+		can slip in between, which is what makes the upgrade "atomic" with respect to other writers. (Writers don't
+		otherwise touch the gate, and it's only allocated when an upgradeable read lock is first requested.) */
+		class CUpgradeGate {
+		public:
+			/* for the upgradeable read lock holder */
+			bool try_lock_upgradeable() {
+				if (std::this_thread::get_id() == m_upgradeable_owner_thread_id.load(std::memory_order_relaxed)) {
+					throw(std::system_error(std::make_error_code(std::errc::resource_deadlock_would_occur)
+						, "this thread already holds an upgradeable lock - mse::impl::CUpgradeGate"));
+				}
+				bool retval = m_upgradeable_mutex.try_lock();
+				if (retval) {
+					m_upgradeable_owner_thread_id.store(std::this_thread::get_id(), std::memory_order_relaxed);
+				}
+				return retval;
+			}
+			/* Blocks until the current upgradeable lock holder (if any) releases it. */
+			void wait_for_upgradeable() {
+				std::lock_guard<std::mutex> lock1(m_upgradeable_mutex);
+			}
+			void unlock_upgradeable() {
+				assert(!m_is_upgraded);
+				m_upgradeable_owner_thread_id.store(std::thread::id(), std::memory_order_relaxed);
+				m_upgradeable_mutex.unlock();
+			}
+			void set_upgraded(bool is_upgraded) {
+				assert(std::this_thread::get_id() == m_upgradeable_owner_thread_id.load(std::memory_order_relaxed));
+				m_is_upgraded = is_upgraded;
+			}
+			bool is_upgraded() const {
+				return m_is_upgraded;
+			}
+			/* (Called while holding the lock on the main mutex, before releasing it.) */
+			void begin_transition() {
+				m_is_in_transition.store(true, std::memory_order_relaxed);
+			}
+			void end_transition() {
+				{
+					std::lock_guard<std::mutex> lock1(m_transition_mutex);
+					m_is_in_transition.store(false, std::memory_order_relaxed);
+				}
+				m_transition_cv.notify_all();
+			}
+
+			/* for writers */
+			void throw_if_upgradeable_owner() const {
+				if ((std::this_thread::get_id() == m_upgradeable_owner_thread_id.load(std::memory_order_relaxed)) && (!m_is_upgraded)) {
+					/* The (shared) lock this thread holds on the main mutex would prevent the write lock from ever being
+					granted. The upgradeable lock needs to be upgraded (via its upgrade() member function) instead. */
+					throw(std::system_error(std::make_error_code(std::errc::resource_deadlock_would_occur)
+						, "write lock requested by the holder of a (non-upgraded) upgradeable lock - mse::impl::CUpgradeGate"));
+				}
+			}
+			/* (Only meaningful while holding the lock on the main mutex, which orders it with begin_transition().) */
+			bool is_in_transition() const {
+				return m_is_in_transition.load(std::memory_order_relaxed);
+			}
+			void wait_for_transition() {
+				std::unique_lock<std::mutex> lock1(m_transition_mutex);
+				m_transition_cv.wait(lock1, [this]() { return !m_is_in_transition.load(std::memory_order_relaxed); });
+			}
+			template<class _Clock, class _Duration>
+			bool wait_for_transition_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
+				std::unique_lock<std::mutex> lock1(m_transition_mutex);
+				return m_transition_cv.wait_until(lock1, _Abs_time, [this]() { return !m_is_in_transition.load(std::memory_order_relaxed); });
+			}
+
+		private:
+			std::mutex m_upgradeable_mutex;
+			std::atomic<std::thread::id> m_upgradeable_owner_thread_id{ std::thread::id() };
+			/* (only accessed by the upgradeable lock holder) */
+			bool m_is_upgraded = false;
+			std::atomic<bool> m_is_in_transition{ false };
+			std::mutex m_transition_mutex;
+			std::condition_variable m_transition_cv;
+		};
+
+		/* Support for "flat combining" (see TAsyncSharedReadWriteAccessRequester::apply()). A request lives (on the
+		stack) in the publishing thread for the duration of the apply() call. */
+		class CFlatCombiningRequestBase {
+		public:
+			virtual ~CFlatCombiningRequestBase() {}
+			virtual void execute() = 0;
+
+			CFlatCombiningRequestBase* m_next_ptr = nullptr;
+			std::exception_ptr m_exception;
+			std::atomic<bool> m_is_done{ false };
+		};
+		template<class _TObj, class _TFunction, class _TResult = typename std::decay<decltype(std::declval<_TFunction&>()(std::declval<_TObj&>()))>::type>
+		class TFlatCombiningRequest : public CFlatCombiningRequestBase {
+		public:
+			typedef _TResult result_type;
+			TFlatCombiningRequest(_TObj& obj_ref, _TFunction& function_ref) : m_obj_ref(obj_ref), m_function_ref(function_ref) {}
+			void execute() override { m_result.emplace(m_function_ref(m_obj_ref)); }
+			result_type result() { return std::move(*m_result); }
+		private:
+			_TObj& m_obj_ref;
+			_TFunction& m_function_ref;
+			std::optional<result_type> m_result;
+		};
+		template<class _TObj, class _TFunction>
+		class TFlatCombiningRequest<_TObj, _TFunction, void> : public CFlatCombiningRequestBase {
+		public:
+			typedef void result_type;
+			TFlatCombiningRequest(_TObj& obj_ref, _TFunction& function_ref) : m_obj_ref(obj_ref), m_function_ref(function_ref) {}
+			void execute() override { m_function_ref(m_obj_ref); }
+			void result() {}
+		private:
+			_TObj& m_obj_ref;
+			_TFunction& m_function_ref;
+		};
+
+		/* Threads publish their requests by pushing them onto a (lock free) stack. Whichever thread obtains the (write)
+		lock becomes the "combiner" and executes all the pending requests in one batch (in the order they were
+		published), while the other publishers spin waiting for their request to be marked as done (blocking on the lock
+		themselves if that takes too long). So the object (and the lock) mostly stay in the combiner's cache rather than
+		moving between cores on every operation. */
+		class CFlatCombiningQueue {
+		public:
+			/* (_TObjLock provides the static lock(), try_lock() and unlock() functions for the (write) lock.) */
+			template<class _TObjLock, class _TObj>
+			void apply(CFlatCombiningRequestBase& request, const _TObj& obj_cref) {
+				auto head_ptr = m_head_ptr.load(std::memory_order_relaxed);
+				do {
+					request.m_next_ptr = head_ptr;
+				} while (!m_head_ptr.compare_exchange_weak(head_ptr, &request, std::memory_order_release, std::memory_order_relaxed));
+
+				size_t num_spins = 0;
+				while (!request.m_is_done.load(std::memory_order_acquire)) {
+					if (sc_max_spins <= num_spins) {
+						/* Our request hasn't been served in a while (presumably the lock is being held by something other
+						than a combiner), so rather than keep spinning we block until we get the lock ourselves. Once we
+						have it, our request is either already done or still in the queue, so the combining pass will
+						take care of it. */
+						_TObjLock::lock(obj_cref);
+						combine();
+						_TObjLock::unlock(obj_cref);
+						assert(request.m_is_done.load(std::memory_order_acquire));
+						break;
+					}
+					/* Mostly we just watch our own request, and only occasionally try for the lock. */
+					if (0 == (num_spins % sc_spins_per_lock_attempt)) {
+						if (_TObjLock::try_lock(obj_cref)) {
+							combine();
+							_TObjLock::unlock(obj_cref);
+							continue;
+						}
+					}
+					num_spins += 1;
+					cpu_relax();
+				}
+				if (request.m_exception) {
+					std::rethrow_exception(request.m_exception);
+				}
+			}
+
+		private:
+			/* The caller must hold the (write) lock. */
+			void combine() {
+				/* (The number of passes is bounded so that the combiner doesn't end up serving other threads indefinitely.) */
+				for (size_t pass = 0; sc_max_combining_passes > pass; pass += 1) {
+					auto lifo_ptr = m_head_ptr.exchange(nullptr, std::memory_order_acquire);
+					if (!lifo_ptr) {
+						break;
+					}
+					CFlatCombiningRequestBase* fifo_ptr = nullptr;
+					while (lifo_ptr) {
+						auto next_ptr = lifo_ptr->m_next_ptr;
+						lifo_ptr->m_next_ptr = fifo_ptr;
+						fifo_ptr = lifo_ptr;
+						lifo_ptr = next_ptr;
+					}
+					while (fifo_ptr) {
+						/* (Once it's marked as done, the request may cease to exist.) */
+						auto next_ptr = fifo_ptr->m_next_ptr;
+						try {
+							fifo_ptr->execute();
+						}
+						catch (...) {
+							fifo_ptr->m_exception = std::current_exception();
+						}
+						fifo_ptr->m_is_done.store(true, std::memory_order_release);
+						fifo_ptr = next_ptr;
+					}
+				}
+			}
+
+			static const size_t sc_spins_per_lock_attempt = 64;
+			static const size_t sc_max_spins = 4096;
+			static const size_t sc_max_combining_passes = 8;
+
+			std::atomic<CFlatCombiningRequestBase*> m_head_ptr{ nullptr };
+		};
+
+#ifdef MSE_ASYNCSHARED_HAS_LOCK_WAIT_QUEUE
+		/* A coroutine waiting (via the async_writelock_ptr() or async_readlock_ptr() functions of the access requesters)
+		for a lock on a shared object, or a thread waiting via one of the std::stop_token lock functions. */
+		class CAsyncLockWaiterBase {
+		public:
+			virtual ~CAsyncLockWaiterBase() {}
+			/* Called (once) after the waiter has been removed from the wait queue. A coroutine waiter is handed to its
+			executor, which (on one of its threads) calls retry(). A thread waiter just wakes its thread. */
+			virtual void schedule() = 0;
+			/* Attempts to acquire the lock and, if successful, resumes the waiting coroutine (on the calling thread).
+			Otherwise the waiter is parked in the object's wait queue again. */
+			virtual void retry() = 0;
+
+			CAsyncLockWaiterBase* m_next_ptr = nullptr;
+		};
+
+		/* Waiters for a lock on a shared object are "parked" in the object's wait queue rather than repeatedly
+		attempting to acquire the lock. Whenever a lock on the object is released, the first waiter in the queue is
+		removed and woken (or handed to its executor) to retry. */
+		class CAsyncLockWaitQueue {
+		public:
+			/* Parks the waiter, unless try_lock() succeeds. Returns the result of try_lock(). */
+			template<class _TTryLock>
+			bool park_unless(CAsyncLockWaiterBase& waiter, const _TTryLock& try_lock, bool at_front) {
+				std::lock_guard<std::mutex> lock1(m_mutex);
+				m_num_waiters.fetch_add(1, std::memory_order_seq_cst);
+				/* (Pairs with the fence in notify_async_lock_waiters(). Either the releasing thread sees this waiter, or
+				this attempt sees the lock released.) */
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				bool acquired = false;
+				try {
+					acquired = try_lock();
+				}
+				catch (...) {
+					m_num_waiters.fetch_sub(1, std::memory_order_relaxed);
+					throw;
+				}
+				if (acquired) {
+					m_num_waiters.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+				if (at_front) {
+					waiter.m_next_ptr = m_head_ptr;
+					m_head_ptr = &waiter;
+					if (!m_tail_ptr) {
+						m_tail_ptr = &waiter;
+					}
+				}
+				else {
+					waiter.m_next_ptr = nullptr;
+					if (m_tail_ptr) {
+						m_tail_ptr->m_next_ptr = &waiter;
+					}
+					else {
+						m_head_ptr = &waiter;
+					}
+					m_tail_ptr = &waiter;
+				}
+				return false;
+			}
+			/* Hands the first waiter (if any) to its executor. */
+			void wake_one() {
+				if (0 == m_num_waiters.load(std::memory_order_relaxed)) {
+					return;
+				}
+				CAsyncLockWaiterBase* waiter_ptr = nullptr;
+				{
+					std::lock_guard<std::mutex> lock1(m_mutex);
+					waiter_ptr = m_head_ptr;
+					if (!waiter_ptr) {
+						return;
+					}
+					m_head_ptr = waiter_ptr->m_next_ptr;
+					if (!m_head_ptr) {
+						m_tail_ptr = nullptr;
+					}
+					m_num_waiters.fetch_sub(1, std::memory_order_relaxed);
+				}
+				waiter_ptr->schedule();
+			}
+			/* Removes the waiter from the queue. Returns false if it wasn't there (because it has already been removed by
+			wake_one()). */
+			bool unpark(CAsyncLockWaiterBase& waiter) {
+				std::lock_guard<std::mutex> lock1(m_mutex);
+				CAsyncLockWaiterBase* prev_ptr = nullptr;
+				for (auto waiter_ptr = m_head_ptr; waiter_ptr; prev_ptr = waiter_ptr, waiter_ptr = waiter_ptr->m_next_ptr) {
+					if (&waiter == waiter_ptr) {
+						(prev_ptr ? prev_ptr->m_next_ptr : m_head_ptr) = waiter_ptr->m_next_ptr;
+						if (m_tail_ptr == waiter_ptr) {
+							m_tail_ptr = prev_ptr;
+						}
+						m_num_waiters.fetch_sub(1, std::memory_order_relaxed);
+						return true;
+					}
+				}
+				return false;
+			}
+
+		private:
+			std::mutex m_mutex;
+			std::atomic<size_t> m_num_waiters{ 0 };
+			/* (an intrusive FIFO list) */
+			CAsyncLockWaiterBase* m_head_ptr = nullptr;
+			CAsyncLockWaiterBase* m_tail_ptr = nullptr;
+		};
+#endif // MSE_ASYNCSHARED_HAS_LOCK_WAIT_QUEUE
+
+#ifdef MSE_ASYNCSHARED_HAS_STOP_TOKEN
+		/* A thread waiting (in a shared object's wait queue) via one of the std::stop_token lock functions. */
+		class CStopTokenLockWaiter : public CAsyncLockWaiterBase {
+		public:
+			void schedule() override {
+				std::lock_guard<std::mutex> lock1(m_mutex);
+				m_is_woken = true;
+				/* (Notified while holding the mutex, as the waiter may be destroyed as soon as the mutex is released.) */
+				m_cv.notify_one();
+			}
+			/* (Thread waiters aren't handed to an executor.) */
+			void retry() override {}
+			/* Called (from a std::stop_callback) when a stop is requested. */
+			void stop() {
+				std::lock_guard<std::mutex> lock1(m_mutex);
+				m_is_stopped = true;
+				m_cv.notify_one();
+			}
+			/* Waits until the waiter is woken or stopped. Returns true if it was woken. */
+			bool wait() {
+				std::unique_lock<std::mutex> lock1(m_mutex);
+				m_cv.wait(lock1, [this]() { return (m_is_woken || m_is_stopped); });
+				const bool is_woken = m_is_woken;
+				m_is_woken = false;
+				return is_woken;
+			}
+			/* Waits until the waiter is woken (even if it has been stopped). */
+			void wait_until_woken() {
+				std::unique_lock<std::mutex> lock1(m_mutex);
+				m_cv.wait(lock1, [this]() { return m_is_woken; });
+				m_is_woken = false;
+			}
+
+		private:
+			std::mutex m_mutex;
+			std::condition_variable m_cv;
+			bool m_is_woken = false;
+			bool m_is_stopped = false;
+		};
+#endif // MSE_ASYNCSHARED_HAS_STOP_TOKEN
+
+		/* The state that only some uses of a shared object require. It's allocated (by TAsyncSharedObj) on first use, so
+		objects that don't use it only pay for a (null) pointer. */
+		class CAsyncSharedObjLazyState {
+		public:
+			/* (Only used by the upgradeable read pointers of the shared_reads lock policy.) */
+			CUpgradeGate m_upgrade_gate;
+			/* (Only used by apply().) */
+			CFlatCombiningQueue m_flat_combining_queue;
+#ifdef MSE_ASYNCSHARED_HAS_LOCK_WAIT_QUEUE
+			/* (Only used by coroutines, and threads using the std::stop_token lock functions, waiting for a lock.) */
+			CAsyncLockWaitQueue m_async_lock_wait_queue;
+#endif // MSE_ASYNCSHARED_HAS_LOCK_WAIT_QUEUE
+		};
+	}
 
 	/* TAsyncSharedObj is intended as a transparent wrapper for other classes/objects. */
 	template<typename _TROy>
 	class TAsyncSharedObj : public _TROy {
 	public:
-		virtual ~TAsyncSharedObj() {}
+		virtual ~TAsyncSharedObj() {
+			delete m_lazy_state_ptr.load(std::memory_order_acquire);
+		}
 		using _TROy::operator=;
 		//TAsyncSharedObj& operator=(TAsyncSharedObj&& _X) { _TROy::operator=(std::move(_X)); return (*this); }
 		TAsyncSharedObj& operator=(typename std::conditional<std::is_const<_TROy>::value
@@ -298,565 +2415,2529 @@ namespace mse {
 		TAsyncSharedObj& operator=(const typename std::conditional<std::is_const<_TROy>::value
 			, std::nullptr_t, TAsyncSharedObj>::type& _X) { _TROy::operator=(_X); return (*this); }
 
+		/* A "pass key" that allows the access requesters' factory functions to construct TAsyncSharedObjs with
+		std::make_shared<>() and std::allocate_shared<>() (i.e. in the same allocation as the control block). */
+		class construction_key {
+		private:
+			construction_key() {}
+			friend class TAsyncSharedObj;
+		};
+		template<typename ...Args>
+		TAsyncSharedObj(construction_key, Args&&... args) : _TROy(std::forward<Args>(args)...) {}
+
+	private:
+		MSE_ASYNC_USING(TAsyncSharedObj, _TROy);
+		TAsyncSharedObj(const TAsyncSharedObj& _X) : _TROy(_X) {}
+		TAsyncSharedObj(TAsyncSharedObj&& _X) : _TROy(std::move(_X)) {}
+		TAsyncSharedObj* operator&() {
+			return this;
+		}
+		const TAsyncSharedObj* operator&() const {
+			return this;
+		}
+
+		typedef typename async_shared_timed_mutex_type_for<typename std::remove_const<_TROy>::type>::type mutex_type;
+		mutable mutex_type m_mutex1;
+		/* (Allocated on first use. See lazy_state().) */
+		mutable std::atomic<impl::CAsyncSharedObjLazyState*> m_lazy_state_ptr{ nullptr };
+
+		static construction_key make_construction_key() { return construction_key(); }
+
+		impl::CAsyncSharedObjLazyState& lazy_state() const {
+			auto lazy_state_ptr = m_lazy_state_ptr.load(std::memory_order_acquire);
+			if (!lazy_state_ptr) {
+				auto new_lazy_state_ptr = new impl::CAsyncSharedObjLazyState();
+				if (m_lazy_state_ptr.compare_exchange_strong(lazy_state_ptr, new_lazy_state_ptr, std::memory_order_acq_rel, std::memory_order_acquire)) {
+					lazy_state_ptr = new_lazy_state_ptr;
+				}
+				else {
+					/* (Another thread got there first.) */
+					delete new_lazy_state_ptr;
+				}
+			}
+			return *lazy_state_ptr;
+		}
+		impl::CAsyncSharedObjLazyState* lazy_state_if_allocated() const {
+			return m_lazy_state_ptr.load(std::memory_order_acquire);
+		}
+
+		lock_metrics_snapshot lock_metrics() const { return impl::lock_metrics_of(m_mutex1, 0); }
+		void set_lock_metrics_label() const { impl::set_lock_metrics_label(m_mutex1, typeid(_TROy).name(), 0); }
+
+		template<typename _Ty2, class _TLockPolicy2, class _TAccessPolicy2> friend class TAsyncSharedAccessRequester;
+		friend class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer<_TROy>;
+		friend class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer<_TROy>;
+		friend class impl::CAsyncSharedPrivateAccess;
+	};
+
+	namespace impl {
+		/* Provides (library internal) access to the private members of TAsyncSharedObjs, pointers and access
+		requesters. */
+		class CAsyncSharedPrivateAccess {
+		public:
+			template<class _TAccessRequester>
+			static auto shptr(const _TAccessRequester& access_requester) -> decltype(access_requester.m_shptr) {
+				return access_requester.m_shptr;
+			}
+			template<class _TObj>
+			static auto mutex(const _TObj& obj) -> decltype(obj.m_mutex1)& {
+				return obj.m_mutex1;
+			}
+			template<class _TObj>
+			static CAsyncSharedObjLazyState& lazy_state(const _TObj& obj) {
+				return obj.lazy_state();
+			}
+			template<class _TObj>
+			static CAsyncSharedObjLazyState* lazy_state_if_allocated(const _TObj& obj) {
+				return obj.lazy_state_if_allocated();
+			}
+			template<class _TObj>
+			static CUpgradeGate* upgrade_gate_if_allocated(const _TObj& obj) {
+				auto lazy_state_ptr = obj.lazy_state_if_allocated();
+				return lazy_state_ptr ? std::addressof(lazy_state_ptr->m_upgrade_gate) : nullptr;
+			}
+			template<class _TPointer, class _TShptr>
+			static _TPointer make_adopting_pointer(const _TShptr& shptr) {
+				return _TPointer(shptr, std::adopt_lock);
+			}
+			template<class _TAccessRequester, class _TShptr>
+			static _TAccessRequester make_access_requester(_TShptr&& shptr) {
+				return _TAccessRequester(std::forward<_TShptr>(shptr));
+			}
+		};
+	}
+
+	namespace impl {
+		template<class _TObj>
+		using async_shared_obj_mutex_t = typename std::remove_reference<decltype(CAsyncSharedPrivateAccess::mutex(std::declval<const _TObj&>()))>::type;
+
+		/* Called after releasing a lock on the object. */
+		template<class _TObj>
+		void notify_async_lock_waiters(const _TObj& obj_cref) {
+#ifdef MSE_ASYNCSHARED_HAS_LOCK_WAIT_QUEUE
+			/* (Pairs with the fence in CAsyncLockWaitQueue::park_unless().) */
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			auto lazy_state_ptr = CAsyncSharedPrivateAccess::lazy_state_if_allocated(obj_cref);
+			if (lazy_state_ptr) {
+				lazy_state_ptr->m_async_lock_wait_queue.wake_one();
+			}
+#else // MSE_ASYNCSHARED_HAS_LOCK_WAIT_QUEUE
+			(void)obj_cref;
+#endif // MSE_ASYNCSHARED_HAS_LOCK_WAIT_QUEUE
+		}
+
+		/* The lock held by a lock pointer (and by a borrowed pointer), as determined by the lock policy, and by whether
+		it's a write lock (access_policy::read_write) or a read lock (access_policy::read_only). The static lock(),
+		try_lock() and unlock() functions are for lock_all(). */
+		template<class _TObj, class _TLockPolicy, class _TAccessPolicy> class TObjLock;
+
+		/* The TObjLock<>s that actually lock the object's mutex release their lock via _TObjLock::unlock(), which also
+		notifies any coroutines waiting for a lock on the object. */
+		template<class _TObj, class _TObjLock>
+		class TObjLockBase {
+		public:
+			TObjLockBase(TObjLockBase&& src) : m_obj_ptr(src.m_obj_ptr), m_owns_lock(src.m_owns_lock) {
+				src.m_owns_lock = false;
+			}
+			~TObjLockBase() {
+				if (m_owns_lock) {
+					_TObjLock::unlock(*m_obj_ptr);
+				}
+			}
+			bool owns_lock() const { return m_owns_lock; }
+
+		protected:
+			TObjLockBase(const _TObj& obj_cref, bool owns_lock) : m_obj_ptr(std::addressof(obj_cref)), m_owns_lock(owns_lock) {}
+
+		private:
+			TObjLockBase& operator=(const TObjLockBase&) = delete;
+
+			const _TObj* m_obj_ptr;
+			bool m_owns_lock;
+		};
+
+		template<class _TObj, class _TAccessPolicy>
+		class TObjLock<_TObj, lock_policy::exclusive_reads, _TAccessPolicy> : public TObjLockBase<_TObj, TObjLock<_TObj, lock_policy::exclusive_reads, _TAccessPolicy>> {
+			typedef TObjLockBase<_TObj, TObjLock> base_class;
+		public:
+			TObjLock(const _TObj& obj_cref) : base_class(obj_cref, (lock(obj_cref), true)) {}
+			TObjLock(const _TObj& obj_cref, std::adopt_lock_t) : base_class(obj_cref, true) {}
+			TObjLock(const _TObj& obj_cref, std::try_to_lock_t) : base_class(obj_cref, try_lock(obj_cref)) {}
+			template<class _Rep, class _Period>
+			TObjLock(const _TObj& obj_cref, std::try_to_lock_t, const std::chrono::duration<_Rep, _Period>& _Rel_time) : base_class(obj_cref, CAsyncSharedPrivateAccess::mutex(obj_cref).try_lock_for(_Rel_time)) {}
+			template<class _Clock, class _Duration>
+			TObjLock(const _TObj& obj_cref, std::try_to_lock_t, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) : base_class(obj_cref, CAsyncSharedPrivateAccess::mutex(obj_cref).try_lock_until(_Abs_time)) {}
+
+			static void lock(const _TObj& obj_cref) { CAsyncSharedPrivateAccess::mutex(obj_cref).lock(); }
+			static bool try_lock(const _TObj& obj_cref) { return CAsyncSharedPrivateAccess::mutex(obj_cref).try_lock(); }
+			static void unlock(const _TObj& obj_cref) {
+				CAsyncSharedPrivateAccess::mutex(obj_cref).unlock();
+				notify_async_lock_waiters(obj_cref);
+			}
+		};
+
+		/* Write locks on objects with the shared_reads lock policy also check, once they've obtained the main mutex,
+		that an upgradeable read lock isn't in the middle of being upgraded (or downgraded). (See CUpgradeGate.) */
+		template<class _TObj>
+		class TObjLock<_TObj, lock_policy::shared_reads, access_policy::read_write> : public TObjLockBase<_TObj, TObjLock<_TObj, lock_policy::shared_reads, access_policy::read_write>> {
+			typedef TObjLockBase<_TObj, TObjLock> base_class;
+		public:
+			TObjLock(const _TObj& obj_cref) : base_class(obj_cref, (lock(obj_cref), true)) {}
+			TObjLock(const _TObj& obj_cref, std::adopt_lock_t) : base_class(obj_cref, true) {}
+			TObjLock(const _TObj& obj_cref, std::try_to_lock_t) : base_class(obj_cref, try_lock(obj_cref)) {}
+			template<class _Rep, class _Period>
+			TObjLock(const _TObj& obj_cref, std::try_to_lock_t, const std::chrono::duration<_Rep, _Period>& _Rel_time) : base_class(obj_cref, try_lock_until(obj_cref, std::chrono::steady_clock::now() + _Rel_time)) {}
+			template<class _Clock, class _Duration>
+			TObjLock(const _TObj& obj_cref, std::try_to_lock_t, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) : base_class(obj_cref, try_lock_until(obj_cref, _Abs_time)) {}
+
+			static void lock(const _TObj& obj_cref) {
+				throw_if_upgradeable_owner(obj_cref);
+				while (true) {
+					CAsyncSharedPrivateAccess::mutex(obj_cref).lock();
+					auto upgrade_gate_ptr = CAsyncSharedPrivateAccess::upgrade_gate_if_allocated(obj_cref);
+					if ((!upgrade_gate_ptr) || (!upgrade_gate_ptr->is_in_transition())) {
+						return;
+					}
+					CAsyncSharedPrivateAccess::mutex(obj_cref).unlock();
+					upgrade_gate_ptr->wait_for_transition();
+				}
+			}
+			static bool try_lock(const _TObj& obj_cref) {
+				throw_if_upgradeable_owner(obj_cref);
+				if (!CAsyncSharedPrivateAccess::mutex(obj_cref).try_lock()) {
+					return false;
+				}
+				auto upgrade_gate_ptr = CAsyncSharedPrivateAccess::upgrade_gate_if_allocated(obj_cref);
+				if (upgrade_gate_ptr && upgrade_gate_ptr->is_in_transition()) {
+					CAsyncSharedPrivateAccess::mutex(obj_cref).unlock();
+					return false;
+				}
+				return true;
+			}
+			template<class _Clock, class _Duration>
+			static bool try_lock_until(const _TObj& obj_cref, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
+				throw_if_upgradeable_owner(obj_cref);
+				while (CAsyncSharedPrivateAccess::mutex(obj_cref).try_lock_until(_Abs_time)) {
+					auto upgrade_gate_ptr = CAsyncSharedPrivateAccess::upgrade_gate_if_allocated(obj_cref);
+					if ((!upgrade_gate_ptr) || (!upgrade_gate_ptr->is_in_transition())) {
+						return true;
+					}
+					CAsyncSharedPrivateAccess::mutex(obj_cref).unlock();
+					if (!upgrade_gate_ptr->wait_for_transition_until(_Abs_time)) {
+						return false;
+					}
+				}
+				return false;
+			}
+			static void unlock(const _TObj& obj_cref) {
+				CAsyncSharedPrivateAccess::mutex(obj_cref).unlock();
+				notify_async_lock_waiters(obj_cref);
+			}
+		private:
+			static void throw_if_upgradeable_owner(const _TObj& obj_cref) {
+				auto upgrade_gate_ptr = CAsyncSharedPrivateAccess::upgrade_gate_if_allocated(obj_cref);
+				if (upgrade_gate_ptr) {
+					upgrade_gate_ptr->throw_if_upgradeable_owner();
+				}
+			}
+		};
+
+		template<class _TObj>
+		class TObjLock<_TObj, lock_policy::shared_reads, access_policy::read_only> : public TObjLockBase<_TObj, TObjLock<_TObj, lock_policy::shared_reads, access_policy::read_only>> {
+			typedef TObjLockBase<_TObj, TObjLock> base_class;
+		public:
+			TObjLock(const _TObj& obj_cref) : base_class(obj_cref, (lock(obj_cref), true)) {}
+			TObjLock(const _TObj& obj_cref, std::adopt_lock_t) : base_class(obj_cref, true) {}
+			TObjLock(const _TObj& obj_cref, std::try_to_lock_t) : base_class(obj_cref, try_lock(obj_cref)) {}
+			template<class _Rep, class _Period>
+			TObjLock(const _TObj& obj_cref, std::try_to_lock_t, const std::chrono::duration<_Rep, _Period>& _Rel_time) : base_class(obj_cref, CAsyncSharedPrivateAccess::mutex(obj_cref).try_lock_shared_for(_Rel_time)) {}
+			template<class _Clock, class _Duration>
+			TObjLock(const _TObj& obj_cref, std::try_to_lock_t, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) : base_class(obj_cref, CAsyncSharedPrivateAccess::mutex(obj_cref).try_lock_shared_until(_Abs_time)) {}
+
+			static void lock(const _TObj& obj_cref) { CAsyncSharedPrivateAccess::mutex(obj_cref).lock_shared(); }
+			static bool try_lock(const _TObj& obj_cref) { return CAsyncSharedPrivateAccess::mutex(obj_cref).try_lock_shared(); }
+			static void unlock(const _TObj& obj_cref) {
+				CAsyncSharedPrivateAccess::mutex(obj_cref).unlock_shared();
+				notify_async_lock_waiters(obj_cref);
+			}
+		};
+
+		template<class _TObj, class _TAccessPolicy>
+		class TObjLock<_TObj, lock_policy::no_locking, _TAccessPolicy> {
+		public:
+			TObjLock(const _TObj&) {}
+			TObjLock(const _TObj&, std::adopt_lock_t) {}
+			template<class... _TTryArgs>
+			TObjLock(const _TObj&, std::try_to_lock_t, const _TTryArgs&...) {}
+			bool owns_lock() const { return true; }
+
+			static void lock(const _TObj&) {}
+			static bool try_lock(const _TObj&) { return true; }
+			static void unlock(const _TObj&) {}
+		};
+
+		/* The (possibly const) shared object held by access requesters and lock pointers with the given access policy. */
+		template<typename _Ty, class _TAccessPolicy>
+		using access_policy_obj_t = typename std::conditional<std::is_same<_TAccessPolicy, access_policy::read_write>::value
+			, TAsyncSharedObj<_Ty>, const TAsyncSharedObj<_Ty>>::type;
+	}
+
+	/* A "borrowed" lock pointer holds a lock on the shared object like the other lock pointers do, but rather than a
+	(std::shared_ptr) owning pointer to the object, it holds a plain reference. So obtaining one doesn't involve
+	modifying the (shared) reference count. In return, a borrowed pointer must not outlive the access requester it was
+	obtained from. To help ensure that, borrowed pointers can't be copied or moved (so they're only usable as local
+	variables), and they can't be obtained from temporary access requesters. */
+	template<typename _TTargetObj, class _TLock>
+	class TAsyncSharedBorrowedPointer {
+	public:
+		TAsyncSharedBorrowedPointer(const TAsyncSharedBorrowedPointer&) = delete;
+		TAsyncSharedBorrowedPointer(TAsyncSharedBorrowedPointer&&) = delete;
+
+		_TTargetObj& operator*() const {
+			return m_obj_ref;
+		}
+		_TTargetObj* operator->() const {
+			return std::addressof(m_obj_ref);
+		}
+	private:
+		template<class _TObj>
+		TAsyncSharedBorrowedPointer(_TObj& obj_ref) : m_lock(obj_ref), m_obj_ref(reinterpret_cast<_TTargetObj&>(obj_ref)) {}
+		TAsyncSharedBorrowedPointer& operator=(const TAsyncSharedBorrowedPointer&) = delete;
+		TAsyncSharedBorrowedPointer& operator=(TAsyncSharedBorrowedPointer&&) = delete;
+
+		TAsyncSharedBorrowedPointer* operator&() { return this; }
+		const TAsyncSharedBorrowedPointer* operator&() const { return this; }
+
+		_TLock m_lock;
+		_TTargetObj& m_obj_ref;
+
+		template<typename _Ty2, class _TLockPolicy2, class _TAccessPolicy2> friend class TAsyncSharedAccessRequester;
+	};
+
+#ifdef MSE_ASYNCSHARED_HAS_COROUTINES
+	/* A (small) pool of threads on which coroutines waiting for a lock (via the async_writelock_ptr() and
+	async_readlock_ptr() functions of the access requesters) are resumed. A waiting coroutine doesn't occupy a thread,
+	so any number of them can wait on a handful of threads. Waiting coroutines are parked in the (per-object) wait
+	queue of the object they're waiting on, and whenever a lock on that object is released the first of them is handed
+	to the executor, whose threads attempt to acquire its lock and resume the coroutine (on the thread that acquired
+	the lock). (If the attempt fails, the coroutine goes back to the front of the object's wait queue.) So the executor
+	doesn't poll.
+	Note that the lock pointers must not be held across a suspension point (i.e. a co_await or co_yield), both
+	because the mutexes are owned by the thread that acquired them, and because (recursive) lock acquisitions by other
+	coroutines running on the same thread would succeed. The destructor waits for all the waiting coroutines to
+	obtain their locks. The default executor is never destroyed, so program exit doesn't wait for any coroutines still
+	waiting on it. */
+	class async_lock_executor {
+	public:
+		explicit async_lock_executor(size_t num_threads = std::max(size_t(1), size_t(std::thread::hardware_concurrency()))) {
+			for (size_t i = 0; i < num_threads; i += 1) {
+				m_threads.emplace_back([this]() { run(); });
+			}
+		}
+		~async_lock_executor() {
+			{
+				std::unique_lock<std::mutex> lock1(m_mutex);
+				m_idle_cv.wait(lock1, [this]() { return (0 == m_num_waiters); });
+				m_stopping = true;
+			}
+			m_cv.notify_all();
+			for (auto& thread_ref : m_threads) {
+				thread_ref.join();
+			}
+		}
+		async_lock_executor(const async_lock_executor&) = delete;
+		async_lock_executor& operator=(const async_lock_executor&) = delete;
+
+		static async_lock_executor& default_executor() {
+			/* (Intentionally never destroyed.) */
+			static async_lock_executor* s_default_executor_ptr = new async_lock_executor();
+			return *s_default_executor_ptr;
+		}
+
+		size_t num_threads() const { return m_threads.size(); }
+		/* The number of coroutines (using this executor) that are waiting for a lock. */
+		size_t num_waiters() const {
+			std::lock_guard<std::mutex> lock1(m_mutex);
+			return m_num_waiters;
+		}
+
+	private:
+		void waiter_added() {
+			std::lock_guard<std::mutex> lock1(m_mutex);
+			m_num_waiters += 1;
+		}
+		void waiter_resumed() {
+			bool is_idle = false;
+			{
+				std::lock_guard<std::mutex> lock1(m_mutex);
+				m_num_waiters -= 1;
+				is_idle = (0 == m_num_waiters);
+			}
+			if (is_idle) {
+				m_idle_cv.notify_all();
+			}
+		}
+		void schedule(impl::CAsyncLockWaiterBase& waiter) {
+			{
+				std::lock_guard<std::mutex> lock1(m_mutex);
+				m_ready_waiters.push_back(&waiter);
+			}
+			m_cv.notify_one();
+		}
+
+		void run() {
+			std::unique_lock<std::mutex> lock1(m_mutex);
+			while (true) {
+				if (m_ready_waiters.empty()) {
+					if (m_stopping) {
+						break;
+					}
+					m_cv.wait(lock1);
+					continue;
+				}
+				auto waiter_ptr = m_ready_waiters.front();
+				m_ready_waiters.pop_front();
+				lock1.unlock();
+				/* (Note that the waiter may no longer exist once this call returns.) */
+				waiter_ptr->retry();
+				lock1.lock();
+			}
+		}
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::condition_variable m_idle_cv;
+		std::deque<impl::CAsyncLockWaiterBase*> m_ready_waiters;
+		size_t m_num_waiters = 0;
+		bool m_stopping = false;
+		std::vector<std::thread> m_threads;
+
+		template<class _TAccessRequester, class _TPointer, class _TTryLock> friend class TAsyncSharedLockAwaitable;
+	};
+
+	/* A minimal (eagerly started) coroutine return type for coroutines that use the awaitable lock functions. The
+	coroutine runs until its first suspension when called. wait() blocks until it has completed (and rethrows any
+	exception that escaped it). */
+	class asyncshared_task {
+	private:
+		class CState {
+		public:
+			std::mutex m_mutex;
+			std::condition_variable m_cv;
+			bool m_done = false;
+			std::exception_ptr m_exception;
+		};
+	public:
+		class promise_type {
+		public:
+			promise_type() : m_state_shptr(std::make_shared<CState>()) {}
+			~promise_type() {
+				/* The coroutine's local variables (including any lock pointers) have been destroyed by now. */
+				{
+					std::lock_guard<std::mutex> lock1(m_state_shptr->m_mutex);
+					m_state_shptr->m_done = true;
+				}
+				m_state_shptr->m_cv.notify_all();
+			}
+			asyncshared_task get_return_object() { return asyncshared_task(m_state_shptr); }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { m_state_shptr->m_exception = std::current_exception(); }
+		private:
+			std::shared_ptr<CState> m_state_shptr;
+		};
+
+		bool done() const {
+			std::lock_guard<std::mutex> lock1(m_state_shptr->m_mutex);
+			return m_state_shptr->m_done;
+		}
+		void wait() const {
+			std::unique_lock<std::mutex> lock1(m_state_shptr->m_mutex);
+			m_state_shptr->m_cv.wait(lock1, [this]() { return m_state_shptr->m_done; });
+			if (m_state_shptr->m_exception) {
+				std::rethrow_exception(m_state_shptr->m_exception);
+			}
+		}
+
+	private:
+		asyncshared_task(const std::shared_ptr<CState>& state_shptr) : m_state_shptr(state_shptr) {}
+
+		std::shared_ptr<CState> m_state_shptr;
+	};
+
+	namespace impl {
+		class CAsyncTryWritelock {
+		public:
+			static const bool sc_is_read_lock = false;
+			template<class _TAccessRequester>
+			static auto try_lock(_TAccessRequester& access_requester) { return access_requester.try_writelock_ptr(); }
+		};
+		class CAsyncTryReadlock {
+		public:
+			static const bool sc_is_read_lock = true;
+			template<class _TAccessRequester>
+			static auto try_lock(_TAccessRequester& access_requester) { return access_requester.try_readlock_ptr(); }
+		};
+	}
+
+	/* The (single use) awaitable returned by the async_writelock_ptr() and async_readlock_ptr() functions of the
+	access requesters. co_await-ing it yields the requested lock pointer. If the lock is immediately available the
+	coroutine isn't suspended, otherwise it waits in the object's wait queue, and is resumed on one of the given
+	executor's threads once the lock has been acquired. (See async_lock_executor.) */
+	template<class _TAccessRequester, class _TPointer, class _TTryLock>
+	class TAsyncSharedLockAwaitable : private impl::CAsyncLockWaiterBase {
+	public:
+		TAsyncSharedLockAwaitable(const TAsyncSharedLockAwaitable&) = delete;
+		TAsyncSharedLockAwaitable(TAsyncSharedLockAwaitable&&) = delete;
+
+		bool await_ready() { return try_acquire(); }
+		bool await_suspend(std::coroutine_handle<> handle) {
+			m_handle = handle;
+			m_executor_ref.waiter_added();
+			if (park(false)) {
+				/* The lock became available in the meantime. */
+				m_executor_ref.waiter_resumed();
+				return false;
+			}
+			/* (Once parked, the awaitable may be resumed (and destroyed) by another thread at any time.) */
+			return true;
+		}
+		_TPointer await_resume() {
+			if (m_exception) {
+				std::rethrow_exception(m_exception);
+			}
+			return std::move(*m_pointer);
+		}
+
+	private:
+		TAsyncSharedLockAwaitable(const _TAccessRequester& access_requester, async_lock_executor& executor)
+			: m_access_requester(access_requester), m_executor_ref(executor) {}
+		TAsyncSharedLockAwaitable& operator=(const TAsyncSharedLockAwaitable&) = delete;
+		TAsyncSharedLockAwaitable& operator=(TAsyncSharedLockAwaitable&&) = delete;
+
+		/* Returns true if the lock was acquired (or the attempt threw). */
+		bool try_acquire() {
+			try {
+				auto pointer = _TTryLock::try_lock(m_access_requester);
+				if (!pointer) {
+					return false;
+				}
+				m_pointer.emplace(std::move(pointer));
+			}
+			catch (...) {
+				m_exception = std::current_exception();
+			}
+			return true;
+		}
+		/* Parks the waiter in the object's wait queue, unless the lock can be acquired. Returns true if the lock was
+		acquired (or the attempt threw). */
+		bool park(bool at_front) {
+			return wait_queue().park_unless(*this, [this]() { return try_acquire(); }, at_front);
+		}
+		impl::CAsyncLockWaitQueue& wait_queue() const {
+			return impl::CAsyncSharedPrivateAccess::lazy_state(*impl::CAsyncSharedPrivateAccess::shptr(m_access_requester)).m_async_lock_wait_queue;
+		}
+		void schedule() override {
+			m_executor_ref.schedule(*this);
+		}
+		void retry() override {
+			if (try_acquire() || park(true)) {
+				if (_TTryLock::sc_is_read_lock) {
+					/* Other waiting readers may be able to acquire their (shared) locks too. */
+					wait_queue().wake_one();
+				}
+				auto& executor_ref = m_executor_ref;
+				m_handle.resume();
+				executor_ref.waiter_resumed();
+			}
+		}
+
+		_TAccessRequester m_access_requester;
+		async_lock_executor& m_executor_ref;
+		std::coroutine_handle<> m_handle;
+		std::optional<_TPointer> m_pointer;
+		std::exception_ptr m_exception;
+
+		template<typename _Ty2, class _TLockPolicy2, class _TAccessPolicy2> friend class TAsyncSharedAccessRequester;
+	};
+#endif // MSE_ASYNCSHARED_HAS_COROUTINES
+
+#ifdef MSE_ASYNCSHARED_HAS_STOP_TOKEN
+	namespace impl {
+		/* There's no way to interrupt a (blocking) mutex lock, so rather than blocking in the mutex, the waiting thread is
+		parked in the shared object's wait queue (see CAsyncLockWaitQueue), from which it's woken either when a lock on
+		the object is released, or (via a std::stop_callback) when a stop is requested. Note that this means the waiter
+		doesn't hold a place in the mutex's own queue. So the mutex's fairness (or priority) policy doesn't apply to it,
+		only the (first come, first served) order of the wait queue. */
+		template<class _TTryLock>
+		auto lock_unless_stop_requested(const std::stop_token& stop_token, CAsyncLockWaitQueue& wait_queue, bool is_read_lock, const _TTryLock& try_lock) -> decltype(try_lock()) {
+			auto first_lock_ptr = try_lock();
+			if (first_lock_ptr || stop_token.stop_requested()) {
+				return first_lock_ptr;
+			}
+			std::optional<decltype(try_lock())> maybe_lock_ptr;
+			auto try_lock_into_maybe_lock_ptr = [&]() {
+				maybe_lock_ptr.emplace(try_lock());
+				return bool(*maybe_lock_ptr);
+			};
+			CStopTokenLockWaiter waiter;
+			/* (Declared after the waiter, so that it's destroyed (and any callback that's running has finished) first.) */
+			std::stop_callback stop_callback(stop_token, [&waiter]() { waiter.stop(); });
+			bool at_front = false;
+			while (true) {
+				if (wait_queue.park_unless(waiter, try_lock_into_maybe_lock_ptr, at_front)) {
+					if (is_read_lock) {
+						/* Other waiting readers may be able to acquire their (shared) locks too. */
+						wait_queue.wake_one();
+					}
+					return std::move(*maybe_lock_ptr);
+				}
+				if (!waiter.wait()) {
+					/* stop requested */
+					if (!wait_queue.unpark(waiter)) {
+						/* The waiter was concurrently removed from the queue (to be woken), so wait for that to complete
+						and pass the wakeup on to the next waiter. */
+						waiter.wait_until_woken();
+						wait_queue.wake_one();
+					}
+					return std::move(*maybe_lock_ptr);
+				}
+				if (stop_token.stop_requested()) {
+					wait_queue.wake_one();
+					return std::move(*maybe_lock_ptr);
+				}
+				/* A woken waiter that fails to obtain the lock goes back to the front of the queue. */
+				at_front = true;
+			}
+		}
+
+		/* For lock requesters whose locks don't notify a wait queue, this waits for the lock in (increasing) timed slices,
+		checking for a stop request in between. So a stop request is noticed within a millisecond or so (plus
+		scheduling delay). A waiter that is cancelled this way does not hold a place in the mutex's queue (and so
+		isn't subject to its fairness or priority policy) either. */
+		template<class _TTryLock, class _TTryLockFor>
+		auto lock_unless_stop_requested(const std::stop_token& stop_token, const _TTryLock& try_lock, const _TTryLockFor& try_lock_for) -> decltype(try_lock()) {
+			/* the uncontended case doesn't need to read the clock */
+			auto first_lock_ptr = try_lock();
+			if (first_lock_ptr || stop_token.stop_requested()) {
+				return first_lock_ptr;
+			}
+			const auto max_slice = std::chrono::microseconds(1000);
+			auto slice = std::chrono::microseconds(50);
+			while (true) {
+				auto lock_ptr = try_lock_for(slice);
+				if (lock_ptr || stop_token.stop_requested()) {
+					return lock_ptr;
+				}
+				if (max_slice > slice) {
+					slice *= 2;
+				}
+			}
+		}
+	}
+#endif // MSE_ASYNCSHARED_HAS_STOP_TOKEN
+
+	/* The lock pointer type of TAsyncSharedAccessRequester<>. With access_policy::read_write it's a write lock pointer,
+	and with access_policy::read_only it's a (const) read lock pointer. What kind of lock it actually holds is
+	determined by the lock policy. (See lock_policy.) */
+	template<typename _Ty, class _TLockPolicy, class _TAccessPolicy>
+	class TAsyncSharedAccessPointer {
+		typedef impl::access_policy_obj_t<_Ty, _TAccessPolicy> obj_type;
+		typedef typename std::conditional<std::is_same<_TAccessPolicy, access_policy::read_write>::value
+			, typename std::conditional<std::is_const<_Ty>::value, const TAsyncSharedObj<_Ty>, TAsyncSharedObj<_Ty>>::type
+			, const TAsyncSharedObj<const _Ty>>::type target_type;
+	public:
+		TAsyncSharedAccessPointer(TAsyncSharedAccessPointer&& src) = default;
+		MSE_ASYNCSHARED_POINTER_DESTRUCTOR_PREFIX ~TAsyncSharedAccessPointer() {}
+
+		operator bool() const {
+			//if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedAccessPointer")); }
+			return m_shptr.operator bool();
+		}
+		target_type& operator*() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedAccessPointer");
+			return *reinterpret_cast<target_type*>(std::addressof(*m_shptr));
+		}
+		target_type* operator->() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedAccessPointer");
+			return reinterpret_cast<target_type*>(std::addressof(*m_shptr));
+		}
+	private:
+		TAsyncSharedAccessPointer(const std::shared_ptr<obj_type>& shptr) : m_shptr(shptr), m_lock(*shptr) {}
+		/* for pointers to objects that have already been locked (by lock_all()) */
+		TAsyncSharedAccessPointer(const std::shared_ptr<obj_type>& shptr, std::adopt_lock_t) : m_shptr(shptr), m_lock(*shptr, std::adopt_lock) {}
+		/* (optionally) followed by a duration or a time point */
+		template<class... _TTryArgs>
+		TAsyncSharedAccessPointer(const std::shared_ptr<obj_type>& shptr, std::try_to_lock_t, const _TTryArgs&... try_args) : m_shptr(shptr), m_lock(*shptr, std::try_to_lock, try_args...) {
+			if (!m_lock.owns_lock()) {
+				m_shptr = nullptr;
+			}
+		}
+		TAsyncSharedAccessPointer& operator=(const TAsyncSharedAccessPointer& _Right_cref) = delete;
+		TAsyncSharedAccessPointer& operator=(TAsyncSharedAccessPointer&& _Right) = delete;
+
+		TAsyncSharedAccessPointer* operator&() { return this; }
+		const TAsyncSharedAccessPointer* operator&() const { return this; }
+		bool is_valid() const {
+			bool retval = m_shptr.operator bool();
+			return retval;
+		}
+
+		impl::TAsyncSharedObjPointerHolder<obj_type> m_shptr;
+		impl::TObjLock<TAsyncSharedObj<_Ty>, _TLockPolicy, _TAccessPolicy> m_lock;
+
+		template<typename _Ty2, class _TLockPolicy2, class _TAccessPolicy2> friend class TAsyncSharedAccessRequester;
+		friend class impl::CAsyncSharedPrivateAccess;
+	};
+
+	/* An access requester hands out lock pointers to a shared object. The kind of locks the lock pointers hold is
+	determined by the lock policy (see lock_policy), and whether it can hand out write lock pointers, or only (const)
+	read lock pointers, is determined by the access policy (see access_policy). The older access requester types,
+	like TAsyncSharedReadWriteAccessRequester<> and TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<>,
+	are aliases of this one. A read-only access requester can be constructed from the corresponding read-write one. */
+	template<typename _Ty, class _TLockPolicy, class _TAccessPolicy>
+	class TAsyncSharedAccessRequester {
+		static const bool sc_is_read_write = std::is_same<_TAccessPolicy, access_policy::read_write>::value;
+		typedef impl::access_policy_obj_t<_Ty, _TAccessPolicy> obj_type;
+	public:
+		typedef TAsyncSharedAccessPointer<_Ty, _TLockPolicy, access_policy::read_write> writelock_ptr_type;
+		typedef TAsyncSharedAccessPointer<_Ty, _TLockPolicy, access_policy::read_only> readlock_ptr_type;
+
+		TAsyncSharedAccessRequester(const TAsyncSharedAccessRequester& src_cref) = default;
+		template<class _TAccessPolicy2, class = typename std::enable_if<(!sc_is_read_write) && std::is_same<_TAccessPolicy2, access_policy::read_write>::value>::type>
+		TAsyncSharedAccessRequester(const TAsyncSharedAccessRequester<_Ty, _TLockPolicy, _TAccessPolicy2>& src_cref) : m_shptr(src_cref.m_shptr) {}
+
+		writelock_ptr_type writelock_ptr() {
+			static_assert(sc_is_read_write, "write lock pointers are only available from read-write access requesters");
+			return writelock_ptr_type(m_shptr);
+		}
+		/* Like writelock_ptr(), but the lock request has the given priority. (See rw_fairness::priority_classes.) */
+		writelock_ptr_type writelock_ptr(priority lock_priority) {
+			scoped_lock_priority scoped_priority(lock_priority);
+			return writelock_ptr();
+		}
+#ifdef MSE_ASYNCSHARED_HAS_STOP_TOKEN
+		/* Like writelock_ptr(), but gives up (returning an empty pointer) if a stop is requested via the given stop_token
+		before the lock is obtained. (See impl::lock_unless_stop_requested().) */
+		writelock_ptr_type writelock_ptr(std::stop_token stop_token) {
+			return impl::lock_unless_stop_requested(stop_token, m_shptr->lazy_state().m_async_lock_wait_queue, false
+				, [this]() { return this->try_writelock_ptr(); });
+		}
+#endif // MSE_ASYNCSHARED_HAS_STOP_TOKEN
+		writelock_ptr_type try_writelock_ptr() {
+			static_assert(sc_is_read_write, "write lock pointers are only available from read-write access requesters");
+			return writelock_ptr_type(m_shptr, std::try_to_lock);
+		}
+		template<class _Rep, class _Period>
+		writelock_ptr_type try_writelock_ptr_for(const std::chrono::duration<_Rep, _Period>& _Rel_time) {
+			static_assert(sc_is_read_write, "write lock pointers are only available from read-write access requesters");
+			return writelock_ptr_type(m_shptr, std::try_to_lock, _Rel_time);
+		}
+		template<class _Clock, class _Duration>
+		writelock_ptr_type try_writelock_ptr_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
+			static_assert(sc_is_read_write, "write lock pointers are only available from read-write access requesters");
+			return writelock_ptr_type(m_shptr, std::try_to_lock, _Abs_time);
+		}
+		readlock_ptr_type readlock_ptr() {
+			return readlock_ptr_type(m_shptr);
+		}
+		/* Like readlock_ptr(), but the lock request has the given priority. (See rw_fairness::priority_classes.) */
+		readlock_ptr_type readlock_ptr(priority lock_priority) {
+			scoped_lock_priority scoped_priority(lock_priority);
+			return readlock_ptr_type(m_shptr);
+		}
+#ifdef MSE_ASYNCSHARED_HAS_STOP_TOKEN
+		/* Like readlock_ptr(), but gives up (returning an empty pointer) if a stop is requested via the given stop_token
+		before the lock is obtained. (See impl::lock_unless_stop_requested().) */
+		readlock_ptr_type readlock_ptr(std::stop_token stop_token) {
+			return impl::lock_unless_stop_requested(stop_token, m_shptr->lazy_state().m_async_lock_wait_queue, true
+				, [this]() { return this->try_readlock_ptr(); });
+		}
+#endif // MSE_ASYNCSHARED_HAS_STOP_TOKEN
+		readlock_ptr_type try_readlock_ptr() {
+			return readlock_ptr_type(m_shptr, std::try_to_lock);
+		}
+		template<class _Rep, class _Period>
+		readlock_ptr_type try_readlock_ptr_for(const std::chrono::duration<_Rep, _Period>& _Rel_time) {
+			return readlock_ptr_type(m_shptr, std::try_to_lock, _Rel_time);
+		}
+		template<class _Clock, class _Duration>
+		readlock_ptr_type try_readlock_ptr_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
+			return readlock_ptr_type(m_shptr, std::try_to_lock, _Abs_time);
+		}
+		/* Blocks until no other upgradeable pointer or write pointer to the object exists. Only available with the
+		shared_reads lock policy. (See TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer.) */
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer<_Ty> upgradeable_readlock_ptr() {
+			static_assert(sc_is_read_write && std::is_same<_TLockPolicy, lock_policy::shared_reads>::value
+				, "upgradeable read lock pointers are only available from read-write access requesters with the shared_reads lock policy");
+			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer<_Ty>(m_shptr);
+		}
+
+		typedef TAsyncSharedBorrowedPointer<TAsyncSharedObj<_Ty>, impl::TObjLock<TAsyncSharedObj<_Ty>, _TLockPolicy, access_policy::read_write>> borrowed_writelock_ptr_type;
+		typedef TAsyncSharedBorrowedPointer<const TAsyncSharedObj<const _Ty>, impl::TObjLock<TAsyncSharedObj<_Ty>, _TLockPolicy, access_policy::read_only>> borrowed_readlock_ptr_type;
+		/* (See TAsyncSharedBorrowedPointer.) */
+		borrowed_writelock_ptr_type borrowed_writelock_ptr() & {
+			static_assert(sc_is_read_write, "write lock pointers are only available from read-write access requesters");
+			return borrowed_writelock_ptr_type(*m_shptr);
+		}
+		borrowed_writelock_ptr_type borrowed_writelock_ptr() && = delete;
+		borrowed_readlock_ptr_type borrowed_readlock_ptr() & {
+			return borrowed_readlock_ptr_type(*m_shptr);
+		}
+		borrowed_readlock_ptr_type borrowed_readlock_ptr() && = delete;
+
+		/* Executes function(obj) (where obj is the shared object) under the write lock and returns its result (by value).
+		Rather than always acquiring the lock itself, the calling thread publishes the operation, and whichever thread
+		holds the lock at the time executes all the pending published operations in one batch ("flat combining"). This
+		tends to be much more efficient than writelock_ptr() for short operations on heavily contended objects. Exceptions
+		thrown by the function are propagated to the caller. Note that the function may be executed on a different
+		thread, and must not (directly or indirectly) call apply() on the same object. Only available with the
+		exclusive_reads lock policy. */
+		template<class _TFunction>
+		typename impl::TFlatCombiningRequest<_Ty, _TFunction>::result_type apply(_TFunction function) {
+			static_assert(sc_is_read_write && std::is_same<_TLockPolicy, lock_policy::exclusive_reads>::value
+				, "apply() is only available from read-write access requesters with the exclusive_reads lock policy");
+			impl::TFlatCombiningRequest<_Ty, _TFunction> request(*m_shptr, function);
+			m_shptr->lazy_state().m_flat_combining_queue.template apply<impl::TObjLock<TAsyncSharedObj<_Ty>, lock_policy::exclusive_reads, access_policy::read_write>>(request, *m_shptr);
+			return request.result();
+		}
+#ifdef MSE_ASYNCSHARED_HAS_COROUTINES
+		typedef TAsyncSharedLockAwaitable<TAsyncSharedAccessRequester, writelock_ptr_type, impl::CAsyncTryWritelock> async_writelock_ptr_type;
+		typedef TAsyncSharedLockAwaitable<TAsyncSharedAccessRequester, readlock_ptr_type, impl::CAsyncTryReadlock> async_readlock_ptr_type;
+		/* For use in coroutines: "co_await access_requester.async_writelock_ptr()" suspends the coroutine (rather than blocking
+		the thread) until the lock is obtained. (See async_lock_executor.) */
+		async_writelock_ptr_type async_writelock_ptr(async_lock_executor& executor = async_lock_executor::default_executor()) const {
+			static_assert(sc_is_read_write, "write lock pointers are only available from read-write access requesters");
+			return async_writelock_ptr_type(*this, executor);
+		}
+		async_readlock_ptr_type async_readlock_ptr(async_lock_executor& executor = async_lock_executor::default_executor()) const {
+			return async_readlock_ptr_type(*this, executor);
+		}
+#endif // MSE_ASYNCSHARED_HAS_COROUTINES
+
+		/* (See MSE_ASYNCSHARED_LOCK_METRICS.) */
+		lock_metrics_snapshot lock_metrics() const { return m_shptr->lock_metrics(); }
+
+		template <class... Args>
+		static TAsyncSharedAccessRequester make_asyncsharedaccess(Args&&... args) {
+			std::shared_ptr<obj_type> shptr = std::make_shared<TAsyncSharedObj<_Ty>>(TAsyncSharedObj<_Ty>::make_construction_key(), std::forward<Args>(args)...);
+			shptr->set_lock_metrics_label();
+			TAsyncSharedAccessRequester retval(shptr);
+			return retval;
+		}
+		/* Like make_asyncsharedaccess(), but the shared object (and its reference counts) are allocated with the given allocator. */
+		template <class _TAlloc, class... Args>
+		static TAsyncSharedAccessRequester allocate_asyncsharedaccess(const _TAlloc& alloc, Args&&... args) {
+			std::shared_ptr<obj_type> shptr = std::allocate_shared<TAsyncSharedObj<_Ty>>(alloc, TAsyncSharedObj<_Ty>::make_construction_key(), std::forward<Args>(args)...);
+			shptr->set_lock_metrics_label();
+			TAsyncSharedAccessRequester retval(shptr);
+			return retval;
+		}
+
+		/* The factory functions of the (former) per-policy access requester classes. Each is only available for its
+		policy combination. */
+		template <class... Args>
+		static TAsyncSharedAccessRequester make_asyncsharedreadwrite(Args&&... args) {
+			static_assert(sc_is_read_write && std::is_same<_TLockPolicy, lock_policy::exclusive_reads>::value
+				, "make_asyncsharedreadwrite() is only available from TAsyncSharedReadWriteAccessRequester<>");
+			return make_asyncsharedaccess(std::forward<Args>(args)...);
+		}
+		template <class... Args>
+		static TAsyncSharedAccessRequester make_asyncsharedreadonly(Args&&... args) {
+			static_assert((!sc_is_read_write) && std::is_same<_TLockPolicy, lock_policy::exclusive_reads>::value
+				, "make_asyncsharedreadonly() is only available from TAsyncSharedReadOnlyAccessRequester<>");
+			return make_asyncsharedaccess(std::forward<Args>(args)...);
+		}
+		template <class... Args>
+		static TAsyncSharedAccessRequester make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite(Args&&... args) {
+			static_assert(sc_is_read_write && std::is_same<_TLockPolicy, lock_policy::shared_reads>::value
+				, "make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite() is only available from TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<>");
+			return make_asyncsharedaccess(std::forward<Args>(args)...);
+		}
+		template <class... Args>
+		static TAsyncSharedAccessRequester make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadonly(Args&&... args) {
+			static_assert((!sc_is_read_write) && std::is_same<_TLockPolicy, lock_policy::shared_reads>::value
+				, "make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadonly() is only available from TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<>");
+			return make_asyncsharedaccess(std::forward<Args>(args)...);
+		}
+
 	private:
-		MSE_ASYNC_USING(TAsyncSharedObj, _TROy);
-		TAsyncSharedObj(const TAsyncSharedObj& _X) : _TROy(_X) {}
-		TAsyncSharedObj(TAsyncSharedObj&& _X) : _TROy(std::move(_X)) {}
-		TAsyncSharedObj* operator&() {
-			return this;
+		TAsyncSharedAccessRequester(std::shared_ptr<obj_type> shptr) : m_shptr(shptr) {}
+
+		TAsyncSharedAccessRequester* operator&() { return this; }
+		const TAsyncSharedAccessRequester* operator&() const { return this; }
+
+		std::shared_ptr<obj_type> m_shptr;
+
+		template<typename _Ty2, class _TLockPolicy2, class _TAccessPolicy2> friend class TAsyncSharedAccessRequester;
+		friend class impl::CAsyncSharedPrivateAccess;
+	};
+
+	template <class X, class _TLockPolicy = lock_policy::exclusive_reads, class _TAccessPolicy = access_policy::read_write, class... Args>
+	TAsyncSharedAccessRequester<X, _TLockPolicy, _TAccessPolicy> make_asyncsharedaccess(Args&&... args) {
+		return TAsyncSharedAccessRequester<X, _TLockPolicy, _TAccessPolicy>::make_asyncsharedaccess(std::forward<Args>(args)...);
+	}
+	template <class X, class _TLockPolicy = lock_policy::exclusive_reads, class _TAccessPolicy = access_policy::read_write, class _TAlloc, class... Args>
+	TAsyncSharedAccessRequester<X, _TLockPolicy, _TAccessPolicy> allocate_asyncsharedaccess(const _TAlloc& alloc, Args&&... args) {
+		return TAsyncSharedAccessRequester<X, _TLockPolicy, _TAccessPolicy>::allocate_asyncsharedaccess(alloc, std::forward<Args>(args)...);
+	}
+
+	template <class X, class... Args>
+	TAsyncSharedReadWriteAccessRequester<X> make_asyncsharedreadwrite(Args&&... args) {
+		return TAsyncSharedReadWriteAccessRequester<X>::make_asyncsharedreadwrite(std::forward<Args>(args)...);
+	}
+	template <class X, class _TAlloc, class... Args>
+	TAsyncSharedReadWriteAccessRequester<X> allocate_asyncsharedreadwrite(const _TAlloc& alloc, Args&&... args) {
+		return TAsyncSharedReadWriteAccessRequester<X>::allocate_asyncsharedaccess(alloc, std::forward<Args>(args)...);
+	}
+	template <class X, class... Args>
+	TAsyncSharedReadOnlyAccessRequester<X> make_asyncsharedreadonly(Args&&... args) {
+		return TAsyncSharedReadOnlyAccessRequester<X>::make_asyncsharedreadonly(std::forward<Args>(args)...);
+	}
+	template <class X, class _TAlloc, class... Args>
+	TAsyncSharedReadOnlyAccessRequester<X> allocate_asyncsharedreadonly(const _TAlloc& alloc, Args&&... args) {
+		return TAsyncSharedReadOnlyAccessRequester<X>::allocate_asyncsharedaccess(alloc, std::forward<Args>(args)...);
+	}
+	template <class X, class... Args>
+	TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<X> make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite(Args&&... args) {
+		return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<X>::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite(std::forward<Args>(args)...);
+	}
+	template <class X, class _TAlloc, class... Args>
+	TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<X> allocate_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite(const _TAlloc& alloc, Args&&... args) {
+		return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<X>::allocate_asyncsharedaccess(alloc, std::forward<Args>(args)...);
+	}
+	template <class X, class... Args>
+	TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<X> make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadonly(Args&&... args) {
+		return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<X>::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadonly(std::forward<Args>(args)...);
+	}
+	template <class X, class _TAlloc, class... Args>
+	TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<X> allocate_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadonly(const _TAlloc& alloc, Args&&... args) {
+		return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<X>::allocate_asyncsharedaccess(alloc, std::forward<Args>(args)...);
+	}
+
+
+	template<typename _Ty>
+	class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer {
+	public:
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer(TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer&& src) : m_shptr(std::move(src.m_shptr)) {}
+		MSE_ASYNCSHARED_POINTER_DESTRUCTOR_PREFIX ~TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer() {
+			if (m_shptr) {
+				/* downgrade */
+				auto& upgrade_gate_ref = m_shptr->lazy_state().m_upgrade_gate;
+				upgrade_gate_ref.set_upgraded(false);
+				upgrade_gate_ref.begin_transition();
+				m_shptr->m_mutex1.unlock();
+				m_shptr->m_mutex1.lock_shared();
+				upgrade_gate_ref.end_transition();
+				impl::notify_async_lock_waiters(*m_shptr);
+			}
 		}
-		const TAsyncSharedObj* operator&() const {
-			return this;
+
+		operator bool() const {
+			return m_shptr.operator bool();
+		}
+		TAsyncSharedObj<_Ty>& operator*() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer");
+			return (*m_shptr);
+		}
+		TAsyncSharedObj<_Ty>* operator->() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer");
+			return std::addressof(*m_shptr);
+		}
+	private:
+		/* The caller must hold the upgradeable lock (and the associated read lock on the main mutex). */
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer(const impl::TAsyncSharedObjPointerHolder<TAsyncSharedObj<_Ty>>& shptr) : m_shptr(shptr) {
+			/* upgrade */
+			auto& upgrade_gate_ref = m_shptr->lazy_state().m_upgrade_gate;
+			upgrade_gate_ref.begin_transition();
+			m_shptr->m_mutex1.unlock_shared();
+			try {
+				m_shptr->m_mutex1.lock();
+			}
+			catch (...) {
+				m_shptr->m_mutex1.lock_shared();
+				upgrade_gate_ref.end_transition();
+				throw;
+			}
+			upgrade_gate_ref.end_transition();
+			upgrade_gate_ref.set_upgraded(true);
 		}
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer<_Ty>& operator=(const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer<_Ty>& _Right_cref) = delete;
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer<_Ty>& operator=(TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer<_Ty>&& _Right) = delete;
 
-		mutable async_shared_timed_mutex_type m_mutex1;
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer<_Ty>* operator&() { return this; }
+		const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer<_Ty>* operator&() const { return this; }
+		bool is_valid() const {
+			bool retval = m_shptr.operator bool();
+			return retval;
+		}
 
-		friend class TAsyncSharedReadWriteAccessRequester<_TROy>;
-		friend class TAsyncSharedReadWritePointer<_TROy>;
-		friend class TAsyncSharedReadWriteConstPointer<_TROy>;
-		friend class TAsyncSharedReadOnlyAccessRequester<_TROy>;
-		friend class TAsyncSharedReadOnlyConstPointer<_TROy>;
+		impl::TAsyncSharedObjPointerHolder<TAsyncSharedObj<_Ty>> m_shptr;
 
-		friend class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<_TROy>;
-		friend class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_TROy>;
-		friend class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_TROy>;
-		friend class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<_TROy>;
-		friend class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_TROy>;
+		friend class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer<_Ty>;
 	};
 
+	/* An "upgradeable" read pointer provides (const) access to the object like a read lock pointer does, and coexists
+	with other (non-upgradeable) read lock pointers, but only one upgradeable pointer to a given object can exist at a
+	time. Its upgrade() member function returns a write pointer, and no other thread can modify the object between the
+	time the upgradeable pointer was obtained and the time the write pointer is obtained. So read-check-write sequences
+	don't need to drop their read lock and re-read the object. Note that while it holds an upgradeable pointer, a thread
+	should not hold any other read lock pointers to the object when calling upgrade(), and it should use upgrade() rather
+	than writelock_ptr() to obtain write access (writelock_ptr() would throw). */
 	template<typename _Ty>
-	class TAsyncSharedReadWritePointer {
+	class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer {
+	public:
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer(TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer&& src) : m_shptr(std::move(src.m_shptr)) {}
+		MSE_ASYNCSHARED_POINTER_DESTRUCTOR_PREFIX ~TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer() {
+			if (m_shptr) {
+				m_shptr->lazy_state().m_upgrade_gate.unlock_upgradeable();
+				m_shptr->m_mutex1.unlock_shared();
+				impl::notify_async_lock_waiters(*m_shptr);
+			}
+		}
+
+		operator bool() const {
+			return m_shptr.operator bool();
+		}
+		const TAsyncSharedObj<const _Ty>& operator*() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer");
+			const TAsyncSharedObj<const _Ty>* extra_const_ptr = reinterpret_cast<const TAsyncSharedObj<const _Ty>*>(std::addressof(*m_shptr));
+			return (*extra_const_ptr);
+		}
+		const TAsyncSharedObj<const _Ty>* operator->() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer");
+			const TAsyncSharedObj<const _Ty>* extra_const_ptr = reinterpret_cast<const TAsyncSharedObj<const _Ty>*>(std::addressof(*m_shptr));
+			return extra_const_ptr;
+		}
+
+		/* Atomically trades the read lock for a write lock. The returned pointer reverts it back to a read lock when
+		it's destroyed, and must not outlive this (upgradeable) pointer. Only one upgraded pointer can exist at a time;
+		calling upgrade() again while one exists throws. */
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer<_Ty> upgrade() & {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer");
+			if (m_shptr->lazy_state().m_upgrade_gate.is_upgraded()) {
+				throw(std::system_error(std::make_error_code(std::errc::resource_deadlock_would_occur)
+					, "the upgradeable lock has already been upgraded - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer"));
+			}
+			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer<_Ty>(m_shptr);
+		}
+		/* A temporary upgradeable pointer would release its lock while the upgraded pointer still depends on it. */
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradedWritePointer<_Ty> upgrade() && = delete;
+	private:
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer(const std::shared_ptr<TAsyncSharedObj<_Ty>>& shptr) : m_shptr(shptr) {
+			auto& upgrade_gate_ref = m_shptr->lazy_state().m_upgrade_gate;
+			while (true) {
+				m_shptr->m_mutex1.lock_shared();
+				bool is_locked = false;
+				try {
+					is_locked = upgrade_gate_ref.try_lock_upgradeable();
+				}
+				catch (...) {
+					m_shptr->m_mutex1.unlock_shared();
+					impl::notify_async_lock_waiters(*m_shptr);
+					throw;
+				}
+				if (is_locked) {
+					break;
+				}
+				/* Another thread holds the upgradeable lock. Rather than wait while holding a read lock (which would
+				prevent the other thread from upgrading), we release it, wait, and try again. */
+				m_shptr->m_mutex1.unlock_shared();
+				impl::notify_async_lock_waiters(*m_shptr);
+				upgrade_gate_ref.wait_for_upgradeable();
+			}
+		}
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer<_Ty>& operator=(const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer<_Ty>& _Right_cref) = delete;
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer<_Ty>& operator=(TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer<_Ty>&& _Right) = delete;
+
+		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer<_Ty>* operator&() { return this; }
+		const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesUpgradeableReadPointer<_Ty>* operator&() const { return this; }
+		bool is_valid() const {
+			bool retval = m_shptr.operator bool();
+			return retval;
+		}
+
+		impl::TAsyncSharedObjPointerHolder<TAsyncSharedObj<_Ty>> m_shptr;
+
+		friend class TAsyncSharedAccessRequester<_Ty, lock_policy::shared_reads, access_policy::read_write>;
+	};
+
+	/* A fixed size table of lock "stripes" (each a (recursive) mutex on its own cache line(s)) shared by all the objects
+	shared via the TAsyncSharedStriped... access requesters that use it. Rather than each object having its own mutex,
+	an object is protected by the stripe its address hashes to. The number of stripes is a template parameter, and
+	each table type has a single (global) instance. */
+	template<size_t _NumStripes = 256>
+	class striped_lock_table {
 	public:
-		TAsyncSharedReadWritePointer(TAsyncSharedReadWritePointer&& src) = default;
-		virtual ~TAsyncSharedReadWritePointer() {}
+		static_assert(1 <= _NumStripes, "striped_lock_table<> requires at least one stripe");
+		static const size_t num_stripes = _NumStripes;
+		typedef async_shared_timed_mutex_type mutex_type;
+
+		/* (The table is intentionally never destroyed, so that it remains usable during static destruction.) */
+		static striped_lock_table& instance() {
+			static striped_lock_table* s_table_ptr = new striped_lock_table();
+			return *s_table_ptr;
+		}
+
+		mutex_type& mutex_for(const void* address) {
+			return m_stripes[stripe_index(address)].m_mutex;
+		}
+		static size_t stripe_index(const void* address) {
+			/* (A 64 bit "finalizer" hash, so that objects allocated at regular intervals don't favor some stripes.) */
+			auto bits = uint64_t(reinterpret_cast<uintptr_t>(address));
+			bits ^= bits >> 33;
+			bits *= 0xff51afd7ed558ccdULL;
+			bits ^= bits >> 33;
+			return size_t(bits % _NumStripes);
+		}
+
+	private:
+		striped_lock_table() {}
+		striped_lock_table(const striped_lock_table&) = delete;
+		striped_lock_table& operator=(const striped_lock_table&) = delete;
+
+		class alignas(impl::sc_cache_line_size) CStripe {
+		public:
+			mutex_type m_mutex;
+		};
+		std::array<CStripe, _NumStripes> m_stripes;
+	};
+
+	template<typename _Ty, class _TLockTable> class TAsyncSharedStripedReadWriteAccessRequester;
+
+	template<typename _Ty, class _TLockTable = striped_lock_table<>>
+	class TAsyncSharedStripedReadWritePointer {
+	public:
+		TAsyncSharedStripedReadWritePointer(TAsyncSharedStripedReadWritePointer&& src) = default;
+		MSE_ASYNCSHARED_POINTER_DESTRUCTOR_PREFIX ~TAsyncSharedStripedReadWritePointer() {}
 
 		operator bool() const {
-			//if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedReadWritePointer")); }
 			return m_shptr.operator bool();
 		}
-		typename std::conditional<std::is_const<_Ty>::value
-			, const TAsyncSharedObj<_Ty>&, TAsyncSharedObj<_Ty>&>::type operator*() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedReadWritePointer")); }
+		_Ty& operator*() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedStripedReadWritePointer");
 			return (*m_shptr);
 		}
-		typename std::conditional<std::is_const<_Ty>::value
-			, const TAsyncSharedObj<_Ty>*, TAsyncSharedObj<_Ty>*>::type operator->() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedReadWritePointer")); }
+		_Ty* operator->() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedStripedReadWritePointer");
 			return std::addressof(*m_shptr);
 		}
 	private:
-		TAsyncSharedReadWritePointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1) {}
-		TAsyncSharedReadWritePointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
+		typedef typename _TLockTable::mutex_type mutex_type;
+
+		TAsyncSharedStripedReadWritePointer(const std::shared_ptr<_Ty>& shptr) : m_shptr(shptr), m_unique_lock(_TLockTable::instance().mutex_for(shptr.get())) {}
+		/* for pointers to objects that have already been locked (by lock_all()) */
+		TAsyncSharedStripedReadWritePointer(const std::shared_ptr<_Ty>& shptr, std::adopt_lock_t) : m_shptr(shptr), m_unique_lock(_TLockTable::instance().mutex_for(shptr.get()), std::adopt_lock) {}
+		TAsyncSharedStripedReadWritePointer(const std::shared_ptr<_Ty>& shptr, std::try_to_lock_t) : m_shptr(shptr), m_unique_lock(_TLockTable::instance().mutex_for(shptr.get()), std::defer_lock) {
 			if (!m_unique_lock.try_lock()) {
-				shptr = nullptr;
+				m_shptr = nullptr;
 			}
 		}
 		template<class _Rep, class _Period>
-		TAsyncSharedReadWritePointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::duration<_Rep, _Period>& _Rel_time) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
+		TAsyncSharedStripedReadWritePointer(const std::shared_ptr<_Ty>& shptr, std::try_to_lock_t, const std::chrono::duration<_Rep, _Period>& _Rel_time) : m_shptr(shptr), m_unique_lock(_TLockTable::instance().mutex_for(shptr.get()), std::defer_lock) {
 			if (!m_unique_lock.try_lock_for(_Rel_time)) {
-				shptr = nullptr;
+				m_shptr = nullptr;
 			}
 		}
 		template<class _Clock, class _Duration>
-		TAsyncSharedReadWritePointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
+		TAsyncSharedStripedReadWritePointer(const std::shared_ptr<_Ty>& shptr, std::try_to_lock_t, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) : m_shptr(shptr), m_unique_lock(_TLockTable::instance().mutex_for(shptr.get()), std::defer_lock) {
 			if (!m_unique_lock.try_lock_until(_Abs_time)) {
-				shptr = nullptr;
+				m_shptr = nullptr;
 			}
 		}
-		TAsyncSharedReadWritePointer<_Ty>& operator=(const TAsyncSharedReadWritePointer<_Ty>& _Right_cref) = delete;
-		TAsyncSharedReadWritePointer<_Ty>& operator=(TAsyncSharedReadWritePointer<_Ty>&& _Right) = delete;
+		TAsyncSharedStripedReadWritePointer& operator=(const TAsyncSharedStripedReadWritePointer& _Right_cref) = delete;
+		TAsyncSharedStripedReadWritePointer& operator=(TAsyncSharedStripedReadWritePointer&& _Right) = delete;
 
-		TAsyncSharedReadWritePointer<_Ty>* operator&() { return this; }
-		const TAsyncSharedReadWritePointer<_Ty>* operator&() const { return this; }
+		TAsyncSharedStripedReadWritePointer* operator&() { return this; }
+		const TAsyncSharedStripedReadWritePointer* operator&() const { return this; }
 		bool is_valid() const {
 			bool retval = m_shptr.operator bool();
 			return retval;
 		}
 
-		std::shared_ptr<TAsyncSharedObj<_Ty>> m_shptr;
-		std::unique_lock<async_shared_timed_mutex_type> m_unique_lock;
+		impl::TAsyncSharedObjPointerHolder<_Ty> m_shptr;
+		std::unique_lock<mutex_type> m_unique_lock;
 
-		friend class TAsyncSharedReadWriteAccessRequester<_Ty>;
+		friend class TAsyncSharedStripedReadWriteAccessRequester<_Ty, _TLockTable>;
+		friend class impl::CAsyncSharedPrivateAccess;
 	};
 
-	template<typename _Ty>
-	class TAsyncSharedReadWriteConstPointer {
+	template<typename _Ty, class _TLockTable = striped_lock_table<>>
+	class TAsyncSharedStripedReadWriteConstPointer {
 	public:
-		TAsyncSharedReadWriteConstPointer(TAsyncSharedReadWriteConstPointer&& src) = default;
-		virtual ~TAsyncSharedReadWriteConstPointer() {}
+		TAsyncSharedStripedReadWriteConstPointer(TAsyncSharedStripedReadWriteConstPointer&& src) = default;
+		MSE_ASYNCSHARED_POINTER_DESTRUCTOR_PREFIX ~TAsyncSharedStripedReadWriteConstPointer() {}
 
 		operator bool() const {
-			//if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedReadWriteConstPointer")); }
 			return m_shptr.operator bool();
 		}
-		const TAsyncSharedObj<const _Ty>& operator*() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedReadWriteConstPointer")); }
-			const TAsyncSharedObj<const _Ty>* extra_const_ptr = reinterpret_cast<const TAsyncSharedObj<const _Ty>*>(std::addressof(*m_shptr));
-			return (*extra_const_ptr);
+		const _Ty& operator*() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedStripedReadWriteConstPointer");
+			return (*m_shptr);
 		}
-		const TAsyncSharedObj<const _Ty>* operator->() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedReadWriteConstPointer")); }
-			const TAsyncSharedObj<const _Ty>* extra_const_ptr = reinterpret_cast<const TAsyncSharedObj<const _Ty>*>(std::addressof(*m_shptr));
-			return extra_const_ptr;
+		const _Ty* operator->() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedStripedReadWriteConstPointer");
+			return std::addressof(*m_shptr);
 		}
 	private:
-		TAsyncSharedReadWriteConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1) {}
-		TAsyncSharedReadWriteConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
+		typedef typename _TLockTable::mutex_type mutex_type;
+
+		TAsyncSharedStripedReadWriteConstPointer(const std::shared_ptr<_Ty>& shptr) : m_shptr(shptr), m_unique_lock(_TLockTable::instance().mutex_for(shptr.get())) {}
+		/* for pointers to objects that have already been locked (by lock_all()) */
+		TAsyncSharedStripedReadWriteConstPointer(const std::shared_ptr<_Ty>& shptr, std::adopt_lock_t) : m_shptr(shptr), m_unique_lock(_TLockTable::instance().mutex_for(shptr.get()), std::adopt_lock) {}
+		TAsyncSharedStripedReadWriteConstPointer(const std::shared_ptr<_Ty>& shptr, std::try_to_lock_t) : m_shptr(shptr), m_unique_lock(_TLockTable::instance().mutex_for(shptr.get()), std::defer_lock) {
 			if (!m_unique_lock.try_lock()) {
-				shptr = nullptr;
+				m_shptr = nullptr;
 			}
 		}
 		template<class _Rep, class _Period>
-		TAsyncSharedReadWriteConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::duration<_Rep, _Period>& _Rel_time) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
+		TAsyncSharedStripedReadWriteConstPointer(const std::shared_ptr<_Ty>& shptr, std::try_to_lock_t, const std::chrono::duration<_Rep, _Period>& _Rel_time) : m_shptr(shptr), m_unique_lock(_TLockTable::instance().mutex_for(shptr.get()), std::defer_lock) {
 			if (!m_unique_lock.try_lock_for(_Rel_time)) {
-				shptr = nullptr;
+				m_shptr = nullptr;
 			}
 		}
 		template<class _Clock, class _Duration>
-		TAsyncSharedReadWriteConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
+		TAsyncSharedStripedReadWriteConstPointer(const std::shared_ptr<_Ty>& shptr, std::try_to_lock_t, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) : m_shptr(shptr), m_unique_lock(_TLockTable::instance().mutex_for(shptr.get()), std::defer_lock) {
 			if (!m_unique_lock.try_lock_until(_Abs_time)) {
-				shptr = nullptr;
+				m_shptr = nullptr;
 			}
 		}
-		TAsyncSharedReadWriteConstPointer<_Ty>& operator=(const TAsyncSharedReadWriteConstPointer<_Ty>& _Right_cref) = delete;
-		TAsyncSharedReadWriteConstPointer<_Ty>& operator=(TAsyncSharedReadWriteConstPointer<_Ty>&& _Right) = delete;
+		TAsyncSharedStripedReadWriteConstPointer& operator=(const TAsyncSharedStripedReadWriteConstPointer& _Right_cref) = delete;
+		TAsyncSharedStripedReadWriteConstPointer& operator=(TAsyncSharedStripedReadWriteConstPointer&& _Right) = delete;
 
-		TAsyncSharedReadWriteConstPointer<_Ty>* operator&() { return this; }
-		const TAsyncSharedReadWriteConstPointer<_Ty>* operator&() const { return this; }
+		TAsyncSharedStripedReadWriteConstPointer* operator&() { return this; }
+		const TAsyncSharedStripedReadWriteConstPointer* operator&() const { return this; }
 		bool is_valid() const {
 			bool retval = m_shptr.operator bool();
 			return retval;
 		}
 
-		std::shared_ptr<TAsyncSharedObj<_Ty>> m_shptr;
-		std::unique_lock<async_shared_timed_mutex_type> m_unique_lock;
+		impl::TAsyncSharedObjPointerHolder<_Ty> m_shptr;
+		std::unique_lock<mutex_type> m_unique_lock;
+
+		friend class TAsyncSharedStripedReadWriteAccessRequester<_Ty, _TLockTable>;
+		friend class impl::CAsyncSharedPrivateAccess;
+	};
+
+	/* TAsyncSharedStripedReadWriteAccessRequester is like TAsyncSharedReadWriteAccessRequester, but intended for large
+	numbers of small shared objects (per-account, per-tile, per-key records and such). The shared object doesn't have a
+	mutex of its own. Instead it's protected by one of the stripes of a (global, fixed size) striped_lock_table<>, so
+	the memory overhead per object is just that of a std::make_shared<>() allocation. In return, unrelated objects may
+	contend for the same stripe. Like with TAsyncSharedReadWriteAccessRequester, read locks are exclusive.
+	Because unrelated objects can share a stripe, a thread that holds a lock on one striped object and then waits for a
+	lock on another one could deadlock with a thread doing the same with two (other) objects that happen to map to the
+	same stripes. So when more than one lock is needed at a time, obtain them together with lock_all() (which also
+	handles objects that map to the same stripe). */
+	template<typename _Ty, class _TLockTable = striped_lock_table<>>
+	class TAsyncSharedStripedReadWriteAccessRequester {
+	public:
+		typedef TAsyncSharedStripedReadWritePointer<_Ty, _TLockTable> writelock_ptr_type;
+		typedef TAsyncSharedStripedReadWriteConstPointer<_Ty, _TLockTable> readlock_ptr_type;
+
+		TAsyncSharedStripedReadWriteAccessRequester(const TAsyncSharedStripedReadWriteAccessRequester& src_cref) = default;
+
+		writelock_ptr_type writelock_ptr() {
+			return writelock_ptr_type(m_shptr);
+		}
+#ifdef MSE_ASYNCSHARED_HAS_STOP_TOKEN
+		/* (See TAsyncSharedAccessRequester::writelock_ptr(std::stop_token). Note that, as the object doesn't have a wait
+		queue of its own, this version waits for the lock in timed slices.) */
+		writelock_ptr_type writelock_ptr(std::stop_token stop_token) {
+			return impl::lock_unless_stop_requested(stop_token, [this]() { return this->try_writelock_ptr(); }
+				, [this](auto rel_time) { return this->try_writelock_ptr_for(rel_time); });
+		}
+#endif // MSE_ASYNCSHARED_HAS_STOP_TOKEN
+		writelock_ptr_type try_writelock_ptr() {
+			return writelock_ptr_type(m_shptr, std::try_to_lock);
+		}
+		template<class _Rep, class _Period>
+		writelock_ptr_type try_writelock_ptr_for(const std::chrono::duration<_Rep, _Period>& _Rel_time) {
+			return writelock_ptr_type(m_shptr, std::try_to_lock, _Rel_time);
+		}
+		template<class _Clock, class _Duration>
+		writelock_ptr_type try_writelock_ptr_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
+			return writelock_ptr_type(m_shptr, std::try_to_lock, _Abs_time);
+		}
+		readlock_ptr_type readlock_ptr() {
+			return readlock_ptr_type(m_shptr);
+		}
+#ifdef MSE_ASYNCSHARED_HAS_STOP_TOKEN
+		/* (See TAsyncSharedAccessRequester::readlock_ptr(std::stop_token). Note that, as the object doesn't have a wait
+		queue of its own, this version waits for the lock in timed slices.) */
+		readlock_ptr_type readlock_ptr(std::stop_token stop_token) {
+			return impl::lock_unless_stop_requested(stop_token, [this]() { return this->try_readlock_ptr(); }
+				, [this](auto rel_time) { return this->try_readlock_ptr_for(rel_time); });
+		}
+#endif // MSE_ASYNCSHARED_HAS_STOP_TOKEN
+		readlock_ptr_type try_readlock_ptr() {
+			return readlock_ptr_type(m_shptr, std::try_to_lock);
+		}
+		template<class _Rep, class _Period>
+		readlock_ptr_type try_readlock_ptr_for(const std::chrono::duration<_Rep, _Period>& _Rel_time) {
+			return readlock_ptr_type(m_shptr, std::try_to_lock, _Rel_time);
+		}
+		template<class _Clock, class _Duration>
+		readlock_ptr_type try_readlock_ptr_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
+			return readlock_ptr_type(m_shptr, std::try_to_lock, _Abs_time);
+		}
+
+		template <class... Args>
+		static TAsyncSharedStripedReadWriteAccessRequester make_asyncsharedstripedreadwrite(Args&&... args) {
+			auto shptr = std::make_shared<_Ty>(std::forward<Args>(args)...);
+			TAsyncSharedStripedReadWriteAccessRequester retval(shptr);
+			return retval;
+		}
+		template <class _TAlloc, class... Args>
+		static TAsyncSharedStripedReadWriteAccessRequester allocate_asyncsharedstripedreadwrite(const _TAlloc& alloc, Args&&... args) {
+			auto shptr = std::allocate_shared<_Ty>(alloc, std::forward<Args>(args)...);
+			TAsyncSharedStripedReadWriteAccessRequester retval(shptr);
+			return retval;
+		}
+
+	private:
+		TAsyncSharedStripedReadWriteAccessRequester(std::shared_ptr<_Ty> shptr) : m_shptr(shptr) {}
+
+		TAsyncSharedStripedReadWriteAccessRequester* operator&() { return this; }
+		const TAsyncSharedStripedReadWriteAccessRequester* operator&() const { return this; }
+
+		std::shared_ptr<_Ty> m_shptr;
+
+		friend class impl::CAsyncSharedPrivateAccess;
+	};
+
+	template <class X, class _TLockTable = striped_lock_table<>, class... Args>
+	TAsyncSharedStripedReadWriteAccessRequester<X, _TLockTable> make_asyncsharedstripedreadwrite(Args&&... args) {
+		return TAsyncSharedStripedReadWriteAccessRequester<X, _TLockTable>::make_asyncsharedstripedreadwrite(std::forward<Args>(args)...);
+	}
+	template <class X, class _TLockTable = striped_lock_table<>, class _TAlloc, class... Args>
+	TAsyncSharedStripedReadWriteAccessRequester<X, _TLockTable> allocate_asyncsharedstripedreadwrite(const _TAlloc& alloc, Args&&... args) {
+		return TAsyncSharedStripedReadWriteAccessRequester<X, _TLockTable>::allocate_asyncsharedstripedreadwrite(alloc, std::forward<Args>(args)...);
+	}
+
+
+	/* TAsyncSharedWeakAccessRequester<> is the weak counterpart to the access requesters, analogous to how std::weak_ptr<>
+	is the weak counterpart to std::shared_ptr<>. It doesn't keep the shared object alive, so it's suitable for things
+	like lookup caches that shouldn't prevent (large) shared objects from being deallocated once their actual owners
+	are done with them. try_strong_access_requester() returns a (strong) access requester (in a std::optional<>) if the
+	object still exists. (That's just a std::weak_ptr<>::lock(), i.e. it doesn't involve the object's mutex.) For
+	convenience, there are TAsyncSharedWeak...AccessRequester aliases for each of the (lock based) access requesters. */
+	template<class _TAccessRequester>
+	class TAsyncSharedWeakAccessRequester {
+	public:
+		typedef _TAccessRequester access_requester_type;
+
+		/* (A default constructed weak access requester is expired.) */
+		TAsyncSharedWeakAccessRequester() {}
+		TAsyncSharedWeakAccessRequester(const TAsyncSharedWeakAccessRequester& src_cref) = default;
+		TAsyncSharedWeakAccessRequester(TAsyncSharedWeakAccessRequester&& src) = default;
+		TAsyncSharedWeakAccessRequester(const _TAccessRequester& access_requester) : m_wkptr(impl::CAsyncSharedPrivateAccess::shptr(access_requester)) {}
+		TAsyncSharedWeakAccessRequester& operator=(const TAsyncSharedWeakAccessRequester& src_cref) = default;
+		TAsyncSharedWeakAccessRequester& operator=(TAsyncSharedWeakAccessRequester&& src) = default;
+
+		std::optional<_TAccessRequester> try_strong_access_requester() const {
+			auto shptr = m_wkptr.lock();
+			if (!shptr) {
+				return {};
+			}
+			return impl::CAsyncSharedPrivateAccess::make_access_requester<_TAccessRequester>(std::move(shptr));
+		}
+		/* Note that (unless it returns true) the result may be out of date by the time it's returned. */
+		bool expired() const {
+			return m_wkptr.expired();
+		}
+		void reset() {
+			m_wkptr.reset();
+		}
+
+	private:
+		typedef typename std::remove_reference<decltype(impl::CAsyncSharedPrivateAccess::shptr(std::declval<const _TAccessRequester&>()))>::type shptr_type;
+
+		TAsyncSharedWeakAccessRequester* operator&() { return this; }
+		const TAsyncSharedWeakAccessRequester* operator&() const { return this; }
 
-		friend class TAsyncSharedReadWriteAccessRequester<_Ty>;
+		std::weak_ptr<typename shptr_type::element_type> m_wkptr;
 	};
 
 	template<typename _Ty>
-	class TAsyncSharedReadWriteAccessRequester {
+	using TAsyncSharedWeakReadWriteAccessRequester = TAsyncSharedWeakAccessRequester<TAsyncSharedReadWriteAccessRequester<_Ty>>;
+	template<typename _Ty>
+	using TAsyncSharedWeakReadOnlyAccessRequester = TAsyncSharedWeakAccessRequester<TAsyncSharedReadOnlyAccessRequester<_Ty>>;
+	template<typename _Ty>
+	using TAsyncSharedWeakObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester = TAsyncSharedWeakAccessRequester<TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<_Ty>>;
+	template<typename _Ty>
+	using TAsyncSharedWeakObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester = TAsyncSharedWeakAccessRequester<TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<_Ty>>;
+	template<typename _Ty, class _TLockTable = striped_lock_table<>>
+	using TAsyncSharedWeakStripedReadWriteAccessRequester = TAsyncSharedWeakAccessRequester<TAsyncSharedStripedReadWriteAccessRequester<_Ty, _TLockTable>>;
+
+	namespace impl {
+		template<class _TAccessRequester>
+		bool is_expired_element(const TAsyncSharedWeakAccessRequester<_TAccessRequester>& element) {
+			return element.expired();
+		}
+		template<class _TKey, class _TAccessRequester>
+		bool is_expired_element(const std::pair<_TKey, TAsyncSharedWeakAccessRequester<_TAccessRequester>>& element) {
+			return element.second.expired();
+		}
+	}
+
+	/* Removes the expired weak access requesters from the given container (of weak access requesters, or a map with weak
+	access requesters as the mapped values) in one pass, and returns the number removed. (Intended for periodically
+	pruning caches.) */
+	template<class _TContainer>
+	size_t erase_expired(_TContainer& container) {
+		const auto original_size = container.size();
+		typedef typename std::iterator_traits<typename _TContainer::iterator>::iterator_category iterator_category;
+		if constexpr (std::is_base_of<std::random_access_iterator_tag, iterator_category>::value) {
+			container.erase(std::remove_if(container.begin(), container.end(), [](const auto& element) { return impl::is_expired_element(element); }), container.end());
+		}
+		else {
+			for (auto it = container.begin(); container.end() != it;) {
+				if (impl::is_expired_element(*it)) {
+					it = container.erase(it);
+				}
+				else {
+					++it;
+				}
+			}
+		}
+		return original_size - container.size();
+	}
+
+
+	namespace impl {
+		template<class _TAccessRequester> class TLockAllReadRequest;
+	}
+	/* Used with lock_all() to indicate that a read lock pointer (rather than a write lock pointer) should be obtained
+	from the given (read-write) access requester. */
+	template<class _TAccessRequester>
+	impl::TLockAllReadRequest<_TAccessRequester> readlock_request(const _TAccessRequester& access_requester) {
+		return impl::TLockAllReadRequest<_TAccessRequester>(access_requester);
+	}
+
+	namespace impl {
+		template<class _TAccessRequester>
+		class TLockAllReadRequest {
+		public:
+			const _TAccessRequester& m_access_requester;
+		private:
+			TLockAllReadRequest(const _TAccessRequester& access_requester) : m_access_requester(access_requester) {}
+			friend TLockAllReadRequest<_TAccessRequester> mse::readlock_request<_TAccessRequester>(const _TAccessRequester& access_requester);
+		};
+
+		/* A "lockable" (i.e. lock(), try_lock() and unlock()) adapter for each of the kinds of request lock_all()
+		accepts. */
+		template<class _TRequest> class TLockAllItem;
+
+		template<class _Ty, class _TLockPolicy, class _TAccessPolicy, class _TPointerAccessPolicy>
+		class TAccessRequesterLockAllItem {
+		public:
+			typedef TAsyncSharedAccessPointer<_Ty, _TLockPolicy, _TPointerAccessPolicy> pointer_type;
+			TAccessRequesterLockAllItem(const TAsyncSharedAccessRequester<_Ty, _TLockPolicy, _TAccessPolicy>& access_requester) : m_shptr(CAsyncSharedPrivateAccess::shptr(access_requester)) {}
+			void lock() { lock_type::lock(*m_shptr); }
+			bool try_lock() { return lock_type::try_lock(*m_shptr); }
+			void unlock() { lock_type::unlock(*m_shptr); }
+			pointer_type make_pointer() const { return CAsyncSharedPrivateAccess::make_adopting_pointer<pointer_type>(m_shptr); }
+		private:
+			typedef TObjLock<TAsyncSharedObj<_Ty>, _TLockPolicy, _TPointerAccessPolicy> lock_type;
+			std::shared_ptr<access_policy_obj_t<_Ty, _TAccessPolicy>> m_shptr;
+		};
+
+		/* Read-write access requesters yield write lock pointers and read-only ones yield read lock pointers. */
+		template<class _Ty, class _TLockPolicy, class _TAccessPolicy>
+		class TLockAllItem<TAsyncSharedAccessRequester<_Ty, _TLockPolicy, _TAccessPolicy>> : public TAccessRequesterLockAllItem<_Ty, _TLockPolicy, _TAccessPolicy, _TAccessPolicy> {
+		public:
+			TLockAllItem(const TAsyncSharedAccessRequester<_Ty, _TLockPolicy, _TAccessPolicy>& access_requester) : TAccessRequesterLockAllItem<_Ty, _TLockPolicy, _TAccessPolicy, _TAccessPolicy>(access_requester) {}
+		};
+		template<class _Ty, class _TLockPolicy, class _TAccessPolicy>
+		class TLockAllItem<TLockAllReadRequest<TAsyncSharedAccessRequester<_Ty, _TLockPolicy, _TAccessPolicy>>> : public TAccessRequesterLockAllItem<_Ty, _TLockPolicy, _TAccessPolicy, access_policy::read_only> {
+		public:
+			TLockAllItem(const TLockAllReadRequest<TAsyncSharedAccessRequester<_Ty, _TLockPolicy, _TAccessPolicy>>& request) : TAccessRequesterLockAllItem<_Ty, _TLockPolicy, _TAccessPolicy, access_policy::read_only>(request.m_access_requester) {}
+		};
+
+		/* The TAsyncSharedStriped... objects are locked via their lock table stripe. (Objects that map to the same stripe
+		are fine, since the stripe is just (recursively) locked once for each of them.) */
+		template<class _Ty, class _TLockTable, class _TPointer>
+		class TStripedLockAllItem {
+		public:
+			typedef _TPointer pointer_type;
+			TStripedLockAllItem(const TAsyncSharedStripedReadWriteAccessRequester<_Ty, _TLockTable>& access_requester) : m_shptr(CAsyncSharedPrivateAccess::shptr(access_requester)) {}
+			void lock() { mutex().lock(); }
+			bool try_lock() { return mutex().try_lock(); }
+			void unlock() { mutex().unlock(); }
+			pointer_type make_pointer() const { return CAsyncSharedPrivateAccess::make_adopting_pointer<pointer_type>(m_shptr); }
+		private:
+			typename _TLockTable::mutex_type& mutex() const { return _TLockTable::instance().mutex_for(m_shptr.get()); }
+			std::shared_ptr<_Ty> m_shptr;
+		};
+		template<class _Ty, class _TLockTable>
+		class TLockAllItem<TAsyncSharedStripedReadWriteAccessRequester<_Ty, _TLockTable>> : public TStripedLockAllItem<_Ty, _TLockTable, TAsyncSharedStripedReadWritePointer<_Ty, _TLockTable>> {
+		public:
+			TLockAllItem(const TAsyncSharedStripedReadWriteAccessRequester<_Ty, _TLockTable>& access_requester) : TStripedLockAllItem<_Ty, _TLockTable, TAsyncSharedStripedReadWritePointer<_Ty, _TLockTable>>(access_requester) {}
+		};
+		template<class _Ty, class _TLockTable>
+		class TLockAllItem<TLockAllReadRequest<TAsyncSharedStripedReadWriteAccessRequester<_Ty, _TLockTable>>> : public TStripedLockAllItem<_Ty, _TLockTable, TAsyncSharedStripedReadWriteConstPointer<_Ty, _TLockTable>> {
+		public:
+			TLockAllItem(const TLockAllReadRequest<TAsyncSharedStripedReadWriteAccessRequester<_Ty, _TLockTable>>& request) : TStripedLockAllItem<_Ty, _TLockTable, TAsyncSharedStripedReadWriteConstPointer<_Ty, _TLockTable>>(request.m_access_requester) {}
+		};
+
+		template<class... _TItems>
+		void lock_all_items(_TItems&... items) {
+			std::lock(items...);
+		}
+		template<class _TItem>
+		void lock_all_items(_TItem& item) {
+			item.lock();
+		}
+	}
+
+	/* lock_all() obtains locks on multiple shared objects "simultaneously", without risk of deadlock (regardless of
+	the order in which other threads lock the same objects), and returns a std::tuple of the corresponding lock
+	pointers. Read-write access requesters yield write lock pointers (unless wrapped with readlock_request()), and
+	read-only access requesters yield read lock pointers. Like std::scoped_lock, it uses std::lock()'s "try and back
+	off" algorithm. For example:
+	auto [src_ptr, dest_ptr] = mse::lock_all(source_access_requester, destination_access_requester); */
+	template<class... _TRequests>
+	std::tuple<typename impl::TLockAllItem<_TRequests>::pointer_type...> lock_all(const _TRequests&... requests) {
+		static_assert(1 <= sizeof...(_TRequests), "lock_all() requires at least one access requester");
+		auto items = std::make_tuple(impl::TLockAllItem<_TRequests>(requests)...);
+		std::apply([](auto&... items) { impl::lock_all_items(items...); }, items);
+		return std::apply([](const auto&... items) {
+			return std::tuple<typename impl::TLockAllItem<_TRequests>::pointer_type...>(items.make_pointer()...);
+		}, items);
+	}
+
+
+	namespace impl {
+		/* The state shared by TAsyncSharedSeqLockAccessRequesters. The object's representation is stored as an array of
+		(relaxed) atomic words so that readers that race with a writer (and subsequently discard what they read) don't
+		constitute a data race. */
+		template<typename _Ty>
+		class TSeqLockObj {
+		public:
+			static const size_t sc_num_words = (sizeof(_Ty) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+			template <class... Args>
+			TSeqLockObj(Args&&... args) {
+				store_words(_Ty(std::forward<Args>(args)...));
+			}
+
+			_Ty load() const {
+				uint64_t version = 0;
+				return load(version);
+			}
+			/* Also reports the (even) version number of the returned value. */
+			_Ty load(uint64_t& version_ref) const {
+				std::array<uint64_t, sc_num_words> words;
+				while (true) {
+					const auto version1 = m_version.load(std::memory_order_acquire);
+					if (version1 & 1) {
+						/* a write is in progress */
+						cpu_relax();
+						continue;
+					}
+					for (size_t i = 0; i < sc_num_words; i += 1) {
+						words[i] = m_words[i].load(std::memory_order_relaxed);
+					}
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (m_version.load(std::memory_order_relaxed) == version1) {
+						version_ref = version1;
+						break;
+					}
+				}
+				_Ty retval;
+				std::memcpy(static_cast<void*>(std::addressof(retval)), words.data(), sizeof(_Ty));
+				return retval;
+			}
+			uint64_t version() const {
+				return m_version.load(std::memory_order_acquire);
+			}
+			void store(const _Ty& value) {
+				std::lock_guard<std::mutex> lock1(m_writer_mutex);
+				store_words(value);
+			}
+			template<class _TFunction>
+			_Ty modify(const _TFunction& func) {
+				std::lock_guard<std::mutex> lock1(m_writer_mutex);
+				/* (Holding the writer mutex, there's no need to validate what's read.) */
+				_Ty value;
+				std::array<uint64_t, sc_num_words> words;
+				for (size_t i = 0; i < sc_num_words; i += 1) {
+					words[i] = m_words[i].load(std::memory_order_relaxed);
+				}
+				std::memcpy(static_cast<void*>(std::addressof(value)), words.data(), sizeof(_Ty));
+				func(value);
+				store_words(value);
+				return value;
+			}
+
+			/* (Used by transact().) */
+			std::mutex& writer_mutex() const {
+				return m_writer_mutex;
+			}
+			/* A store in three steps, so that a store to multiple objects can be made to appear atomic (to readers) by
+			beginning all the stores before ending any of them. The caller must hold writer_mutex(). */
+			void begin_store_locked() {
+				m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+			}
+			void write_words_locked(const _Ty& value) {
+				std::array<uint64_t, sc_num_words> words = {};
+				std::memcpy(words.data(), std::addressof(value), sizeof(_Ty));
+				for (size_t i = 0; i < sc_num_words; i += 1) {
+					m_words[i].store(words[i], std::memory_order_relaxed);
+				}
+			}
+			void end_store_locked() {
+				m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			}
+
+		private:
+			/* The caller must hold m_writer_mutex (or be the constructor). */
+			void store_words(const _Ty& value) {
+				begin_store_locked();
+				write_words_locked(value);
+				end_store_locked();
+			}
+
+			/* Readers only ever read the version and the words, so (in the absence of writes) they don't contend for
+			any cache lines. */
+			alignas(sc_cache_line_size) std::atomic<uint64_t> m_version{ 0 };
+			std::array<std::atomic<uint64_t>, sc_num_words> m_words;
+			alignas(sc_cache_line_size) mutable std::mutex m_writer_mutex;
+		};
+	}
+
+	/* TAsyncSharedSeqLockAccessRequester is intended for small, trivially copyable shared objects (counters,
+	coordinates, small records) that are read much more often than they're modified. Rather than locking, readers copy
+	the object out (with load()) and retry if a write occurred during the copy. Writers (store() and modify()) are
+	serialized with a mutex and bump the object's version number. Since readers don't write to any shared memory, reads
+	scale with the number of threads. But note that there's no read or write pointer, only copies of the object. (See
+	also transact() for atomic operations on multiple objects.) */
+	template<typename _Ty>
+	class TAsyncSharedSeqLockAccessRequester {
 	public:
-		TAsyncSharedReadWriteAccessRequester(const TAsyncSharedReadWriteAccessRequester& src_cref) = default;
+		static_assert(std::is_trivially_copyable<_Ty>::value, "TAsyncSharedSeqLockAccessRequester<> requires a trivially copyable type");
+		static_assert(std::is_default_constructible<_Ty>::value, "TAsyncSharedSeqLockAccessRequester<> requires a default constructible type");
+
+		TAsyncSharedSeqLockAccessRequester(const TAsyncSharedSeqLockAccessRequester& src_cref) = default;
 
-		TAsyncSharedReadWritePointer<_Ty> writelock_ptr() {
-			return TAsyncSharedReadWritePointer<_Ty>(m_shptr);
+		/* Returns a (consistent) copy of the shared object. */
+		_Ty load() const {
+			return m_shptr->load();
 		}
-		TAsyncSharedReadWritePointer<_Ty> try_writelock_ptr() {
-			return TAsyncSharedReadWritePointer<_Ty>(m_shptr, std::try_to_lock);
+		void store(const _Ty& value) {
+			m_shptr->store(value);
 		}
-		template<class _Rep, class _Period>
-		TAsyncSharedReadWritePointer<_Ty> try_writelock_ptr_for(const std::chrono::duration<_Rep, _Period>& _Rel_time) {
-			return TAsyncSharedReadWritePointer<_Ty>(m_shptr, std::try_to_lock, _Rel_time);
-		}
-		template<class _Clock, class _Duration>
-		TAsyncSharedReadWritePointer<_Ty> try_writelock_ptr_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
-			return TAsyncSharedReadWritePointer<_Ty>(m_shptr, std::try_to_lock, _Abs_time);
-		}
-		TAsyncSharedReadWriteConstPointer<_Ty> readlock_ptr() {
-			return TAsyncSharedReadWriteConstPointer<_Ty>(m_shptr);
-		}
-		TAsyncSharedReadWriteConstPointer<_Ty> try_readlock_ptr() {
-			return TAsyncSharedReadWriteConstPointer<_Ty>(m_shptr, std::try_to_lock);
-		}
-		template<class _Rep, class _Period>
-		TAsyncSharedReadWriteConstPointer<_Ty> try_readlock_ptr_for(const std::chrono::duration<_Rep, _Period>& _Rel_time) {
-			return TAsyncSharedReadWriteConstPointer<_Ty>(m_shptr, std::try_to_lock, _Rel_time);
-		}
-		template<class _Clock, class _Duration>
-		TAsyncSharedReadWriteConstPointer<_Ty> try_readlock_ptr_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
-			return TAsyncSharedReadWriteConstPointer<_Ty>(m_shptr, std::try_to_lock, _Abs_time);
+		/* Calls func() with a (non-const) reference to a copy of the shared object, then stores the (modified) copy back
+		to the shared object, all while holding the writer lock. Returns the new value. */
+		template<class _TFunction>
+		_Ty modify(const _TFunction& func) {
+			return m_shptr->modify(func);
 		}
 
 		template <class... Args>
-		static TAsyncSharedReadWriteAccessRequester make_asyncsharedreadwrite(Args&&... args) {
-			//auto shptr = std::make_shared<TAsyncSharedObj<_Ty>>(std::forward<Args>(args)...);
-			std::shared_ptr<TAsyncSharedObj<_Ty>> shptr(new TAsyncSharedObj<_Ty>(std::forward<Args>(args)...));
-			TAsyncSharedReadWriteAccessRequester retval(shptr);
+		static TAsyncSharedSeqLockAccessRequester make_asyncsharedseqlock(Args&&... args) {
+			auto shptr = std::make_shared<impl::TSeqLockObj<_Ty>>(std::forward<Args>(args)...);
+			TAsyncSharedSeqLockAccessRequester retval(shptr);
+			return retval;
+		}
+		template <class _TAlloc, class... Args>
+		static TAsyncSharedSeqLockAccessRequester allocate_asyncsharedseqlock(const _TAlloc& alloc, Args&&... args) {
+			auto shptr = std::allocate_shared<impl::TSeqLockObj<_Ty>>(alloc, std::forward<Args>(args)...);
+			TAsyncSharedSeqLockAccessRequester retval(shptr);
 			return retval;
 		}
 
 	private:
-		TAsyncSharedReadWriteAccessRequester(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr) : m_shptr(shptr) {}
+		TAsyncSharedSeqLockAccessRequester(std::shared_ptr<impl::TSeqLockObj<_Ty>> shptr) : m_shptr(shptr) {}
 
-		TAsyncSharedReadWriteAccessRequester<_Ty>* operator&() { return this; }
-		const TAsyncSharedReadWriteAccessRequester<_Ty>* operator&() const { return this; }
+		TAsyncSharedSeqLockAccessRequester<_Ty>* operator&() { return this; }
+		const TAsyncSharedSeqLockAccessRequester<_Ty>* operator&() const { return this; }
 
-		std::shared_ptr<TAsyncSharedObj<_Ty>> m_shptr;
+		std::shared_ptr<impl::TSeqLockObj<_Ty>> m_shptr;
 
-		friend class TAsyncSharedReadOnlyAccessRequester<_Ty>;
+		friend class impl::CAsyncSharedPrivateAccess;
 	};
 
 	template <class X, class... Args>
-	TAsyncSharedReadWriteAccessRequester<X> make_asyncsharedreadwrite(Args&&... args) {
-		return TAsyncSharedReadWriteAccessRequester<X>::make_asyncsharedreadwrite(std::forward<Args>(args)...);
+	TAsyncSharedSeqLockAccessRequester<X> make_asyncsharedseqlock(Args&&... args) {
+		return TAsyncSharedSeqLockAccessRequester<X>::make_asyncsharedseqlock(std::forward<Args>(args)...);
+	}
+	template <class X, class _TAlloc, class... Args>
+	TAsyncSharedSeqLockAccessRequester<X> allocate_asyncsharedseqlock(const _TAlloc& alloc, Args&&... args) {
+		return TAsyncSharedSeqLockAccessRequester<X>::allocate_asyncsharedseqlock(alloc, std::forward<Args>(args)...);
 	}
 
+	namespace impl {
+		/* A transact() participant: a (private, modifiable) copy of the shared object and the version it was copied from. */
+		template<typename _Ty>
+		class TTransactionEntry {
+		public:
+			TTransactionEntry(const std::shared_ptr<TSeqLockObj<_Ty>>& shptr) : m_obj_ptr(shptr.get()) {}
+			void read() {
+				m_original_value = m_obj_ptr->load(m_version);
+				m_value = m_original_value;
+			}
+			bool is_current() const {
+				return (m_obj_ptr->version() == m_version);
+			}
+			bool is_modified() const {
+				return (0 != std::memcmp(std::addressof(m_value), std::addressof(m_original_value), sizeof(_Ty)));
+			}
+			/* The caller must hold the object's writer mutex. (Objects that the transaction didn't modify aren't written,
+			so their versions don't change.) */
+			void begin_commit_locked() {
+				if (is_modified()) {
+					m_obj_ptr->begin_store_locked();
+					m_obj_ptr->write_words_locked(m_value);
+				}
+			}
+			void end_commit_locked() {
+				if (is_modified()) {
+					m_obj_ptr->end_store_locked();
+				}
+			}
 
-	template<typename _Ty>
-	class TAsyncSharedReadOnlyConstPointer {
-	public:
-		TAsyncSharedReadOnlyConstPointer(TAsyncSharedReadOnlyConstPointer&& src) = default;
-		virtual ~TAsyncSharedReadOnlyConstPointer() {}
+			TSeqLockObj<_Ty>* m_obj_ptr;
+			uint64_t m_version = 0;
+			_Ty m_original_value;
+			_Ty m_value;
+		};
+	}
 
-		operator bool() const {
-			//if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedReadOnlyConstPointer")); }
-			return m_shptr.operator bool();
-		}
-		const TAsyncSharedObj<const _Ty>& operator*() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedReadOnlyConstPointer")); }
-			const TAsyncSharedObj<const _Ty>* extra_const_ptr = reinterpret_cast<const TAsyncSharedObj<const _Ty>*>(std::addressof(*m_shptr));
-			return (*extra_const_ptr);
-		}
-		const TAsyncSharedObj<const _Ty>* operator->() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedReadOnlyConstPointer")); }
-			const TAsyncSharedObj<const _Ty>* extra_const_ptr = reinterpret_cast<const TAsyncSharedObj<const _Ty>*>(std::addressof(*m_shptr));
-			return extra_const_ptr;
+	/* transact() performs an (optimistic) transaction on one or more objects shared via TAsyncSharedSeqLockAccessRequesters.
+	The given function is called with (non-const) references to copies of the shared objects. The copies are obtained
+	without locking, and are mutually consistent (i.e. they constitute a snapshot of the objects at a single point in
+	time). After the function returns, the objects' writer locks are (briefly) obtained and, if none of the objects
+	has been modified in the meantime, the modified copies are stored back to the shared objects. Otherwise the whole
+	thing is retried (so the function may be called more than once and shouldn't have side effects). If the function
+	returns a bool, a return value of false aborts the transaction (nothing is stored). The function's return value
+	(from the committed (or aborted) call) is returned. Transactions that don't modify the same objects don't contend
+	for any locks except (briefly) when committing, and transactions that don't modify anything don't lock at all. (So
+	transact() is also the way to read multiple seqlock objects consistently.) For example:
+	bool succeeded = mse::transact([](CAccount& source, CAccount& destination) {
+		if (source.balance() < amount) { return false; }
+		source.add_to_balance(-amount);
+		destination.add_to_balance(amount);
+		return true;
+	}, source_access_requester, destination_access_requester); */
+	template<class _TFunction, class... _Tys>
+	auto transact(const _TFunction& function, const TAsyncSharedSeqLockAccessRequester<_Tys>&... access_requesters) -> decltype(function(std::declval<_Tys&>()...)) {
+		static_assert(1 <= sizeof...(_Tys), "transact() requires at least one access requester");
+		typedef decltype(function(std::declval<_Tys&>()...)) result_type;
+		auto entries = std::make_tuple(impl::TTransactionEntry<_Tys>(impl::CAsyncSharedPrivateAccess::shptr(access_requesters))...);
+
+		/* The writer mutexes are always obtained in (address) order, so concurrent commits can't deadlock. */
+		std::array<std::mutex*, sizeof...(_Tys)> writer_mutex_ptrs = std::apply([](const auto&... entries) {
+			return std::array<std::mutex*, sizeof...(_Tys)>{ { std::addressof(entries.m_obj_ptr->writer_mutex())... } };
+		}, entries);
+		std::sort(writer_mutex_ptrs.begin(), writer_mutex_ptrs.end(), std::less<std::mutex*>());
+		if (writer_mutex_ptrs.end() != std::adjacent_find(writer_mutex_ptrs.begin(), writer_mutex_ptrs.end())) {
+			throw(std::invalid_argument("the same shared object was passed more than once - mse::transact()"));
 		}
-	private:
-		TAsyncSharedReadOnlyConstPointer(std::shared_ptr<const TAsyncSharedObj<_Ty>> shptr) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1) {}
-		TAsyncSharedReadOnlyConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_unique_lock.try_lock()) {
-				shptr = nullptr;
+		auto lock_all_writer_mutexes = [&writer_mutex_ptrs]() {
+			for (auto writer_mutex_ptr : writer_mutex_ptrs) {
+				writer_mutex_ptr->lock();
 			}
-		}
-		template<class _Rep, class _Period>
-		TAsyncSharedReadOnlyConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::duration<_Rep, _Period>& _Rel_time) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_unique_lock.try_lock_for(_Rel_time)) {
-				shptr = nullptr;
+		};
+		auto unlock_all_writer_mutexes = [&writer_mutex_ptrs]() {
+			for (auto it = writer_mutex_ptrs.rbegin(); writer_mutex_ptrs.rend() != it; it++) {
+				(*it)->unlock();
 			}
-		}
-		template<class _Clock, class _Duration>
-		TAsyncSharedReadOnlyConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_unique_lock.try_lock_until(_Abs_time)) {
-				shptr = nullptr;
+		};
+
+		while (true) {
+			/* Obtain a consistent snapshot (i.e. retry if any of the objects was modified while the others were being read). */
+			while (true) {
+				std::apply([](auto&... entries) { (entries.read(), ...); }, entries);
+				const bool all_current = std::apply([](const auto&... entries) { return (entries.is_current() && ...); }, entries);
+				if (all_current) {
+					break;
+				}
 			}
-		}
-		TAsyncSharedReadOnlyConstPointer<_Ty>& operator=(const TAsyncSharedReadOnlyConstPointer<_Ty>& _Right_cref) = delete;
-		TAsyncSharedReadOnlyConstPointer<_Ty>& operator=(TAsyncSharedReadOnlyConstPointer<_Ty>&& _Right) = delete;
 
-		TAsyncSharedReadOnlyConstPointer<_Ty>* operator&() { return this; }
-		const TAsyncSharedReadOnlyConstPointer<_Ty>* operator&() const { return this; }
-		bool is_valid() const {
-			bool retval = m_shptr.operator bool();
-			return retval;
+			auto call_function = [&function, &entries]() -> result_type {
+				return std::apply([&function](auto&... entries) -> result_type { return function(entries.m_value...); }, entries);
+			};
+			auto try_commit = [&]() {
+				const bool any_modified = std::apply([](const auto&... entries) { return (entries.is_modified() || ...); }, entries);
+				if (!any_modified) {
+					/* (The snapshot was consistent, so there's nothing to validate or store.) */
+					return true;
+				}
+				lock_all_writer_mutexes();
+				const bool all_current = std::apply([](const auto&... entries) { return (entries.is_current() && ...); }, entries);
+				if (all_current) {
+					/* (Ending the objects' stores only after all of them have begun ensures that readers see either
+					all or none of the transaction's modifications.) */
+					std::apply([](auto&... entries) { (entries.begin_commit_locked(), ...); }, entries);
+					std::apply([](auto&... entries) { (entries.end_commit_locked(), ...); }, entries);
+				}
+				unlock_all_writer_mutexes();
+				return all_current;
+			};
+
+			if constexpr (std::is_void<result_type>::value) {
+				call_function();
+				if (try_commit()) {
+					return;
+				}
+			}
+			else {
+				auto result = call_function();
+				if constexpr (std::is_same<result_type, bool>::value) {
+					if (!result) {
+						/* aborted */
+						return result;
+					}
+				}
+				if (try_commit()) {
+					return result;
+				}
+			}
+			/* (There was a conflicting modification. Give the other thread a chance to finish before retrying.) */
+			std::this_thread::yield();
 		}
+	}
 
-		std::shared_ptr<const TAsyncSharedObj<_Ty>> m_shptr;
-		std::unique_lock<async_shared_timed_mutex_type> m_unique_lock;
+	namespace impl {
+		/* Where std::atomic<>::wait() isn't available (i.e. pre-C++20), waiting on an atomic object is implemented with a
+		(small, static) table of mutex/condition variable pairs indexed by the object's address. */
+		class CAtomicWaitTable {
+		public:
+			class CEntry {
+			public:
+				std::mutex m_mutex;
+				std::condition_variable m_cv;
+				std::atomic<size_t> m_num_waiters{ 0 };
+			};
+			static CEntry& entry_for(const void* address) {
+				static std::array<CEntry, sc_num_entries> s_entries;
+				return s_entries[(reinterpret_cast<uintptr_t>(address) / sizeof(uint64_t)) % sc_num_entries];
+			}
 
-		friend class TAsyncSharedReadOnlyAccessRequester<_Ty>;
-	};
+			template<typename _Ty>
+			static void wait(const std::atomic<_Ty>& atomic_cref, _Ty old_value, std::memory_order order) {
+				auto& entry_ref = entry_for(std::addressof(atomic_cref));
+				while (equals(atomic_cref.load(order), old_value)) {
+					std::unique_lock<std::mutex> lock1(entry_ref.m_mutex);
+					entry_ref.m_num_waiters.fetch_add(1, std::memory_order_seq_cst);
+					/* (Pairs with the fence in notify(). Either the notifier sees this waiter, or this re-check sees the new
+					value.) */
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					/* (Re-checking after registering as a waiter (and holding the mutex) means a notification can't be missed.) */
+					if (equals(atomic_cref.load(std::memory_order_seq_cst), old_value)) {
+						entry_ref.m_cv.wait(lock1);
+					}
+					entry_ref.m_num_waiters.fetch_sub(1, std::memory_order_relaxed);
+				}
+			}
+			/* Like wait(), but gives up after rel_time. Returns whether the value (was observed to have) changed. */
+			template<typename _Ty, class _Rep, class _Period>
+			static bool wait_for(const std::atomic<_Ty>& atomic_cref, _Ty old_value, std::memory_order order, const std::chrono::duration<_Rep, _Period>& rel_time) {
+				auto& entry_ref = entry_for(std::addressof(atomic_cref));
+				const auto abs_time = std::chrono::steady_clock::now() + rel_time;
+				while (equals(atomic_cref.load(order), old_value)) {
+					std::unique_lock<std::mutex> lock1(entry_ref.m_mutex);
+					entry_ref.m_num_waiters.fetch_add(1, std::memory_order_seq_cst);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					bool timed_out = false;
+					if (equals(atomic_cref.load(std::memory_order_seq_cst), old_value)) {
+						timed_out = (std::cv_status::timeout == entry_ref.m_cv.wait_until(lock1, abs_time));
+					}
+					entry_ref.m_num_waiters.fetch_sub(1, std::memory_order_relaxed);
+					if (timed_out) {
+						return !equals(atomic_cref.load(order), old_value);
+					}
+				}
+				return true;
+			}
+			template<typename _Ty>
+			static void notify(const std::atomic<_Ty>& atomic_cref) {
+				auto& entry_ref = entry_for(std::addressof(atomic_cref));
+				/* The caller's modification of the atomic object may be a (mere) release store, which could otherwise be
+				reordered after the load of the waiter count, with the result that neither this thread sees the waiter nor
+				the waiter sees the new value (i.e. a lost wakeup). */
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (0 != entry_ref.m_num_waiters.load(std::memory_order_seq_cst)) {
+					{
+						std::lock_guard<std::mutex> lock1(entry_ref.m_mutex);
+					}
+					/* (Other objects may share the entry, so all its waiters are woken to re-check.) */
+					entry_ref.m_cv.notify_all();
+				}
+			}
 
+		private:
+			static const size_t sc_num_entries = 16;
+
+			/* Compares value representations, like std::atomic<>::wait() does. */
+			template<typename _Ty>
+			static bool equals(const _Ty& value1, const _Ty& value2) {
+				return (0 == std::memcmp(std::addressof(value1), std::addressof(value2), sizeof(_Ty)));
+			}
+		};
+	}
+
+	/* TAsyncSharedV2AtomicFixedPointer is a (shared, never null) pointer to a std::atomic<> object. For small trivially
+	copyable objects (counters, flags, indexes) that can be shared atomically, it avoids both the locking and the mutex
+	(per object) of the access requesters. Dereferencing it yields the std::atomic<> object itself, and for convenience
+	the std::atomic<> operations (with their memory order parameters) are also available as member functions. wait()
+	and notify_one()/notify_all() are supported even when compiling as C++17 (where std::atomic<> doesn't have them).
+	Use mse::make_asyncsharedv2atomic<>() to construct one. */
 	template<typename _Ty>
-	class TAsyncSharedReadOnlyAccessRequester {
+	class TAsyncSharedV2AtomicFixedPointer {
 	public:
-		TAsyncSharedReadOnlyAccessRequester(const TAsyncSharedReadOnlyAccessRequester& src_cref) = default;
-		TAsyncSharedReadOnlyAccessRequester(const TAsyncSharedReadWriteAccessRequester<_Ty>& src_cref) : m_shptr(src_cref.m_shptr) {}
+		static_assert(std::is_trivially_copyable<_Ty>::value, "TAsyncSharedV2AtomicFixedPointer<> requires a trivially copyable type");
 
-		TAsyncSharedReadOnlyConstPointer<_Ty> readlock_ptr() {
-			return TAsyncSharedReadOnlyConstPointer<_Ty>(m_shptr);
+		TAsyncSharedV2AtomicFixedPointer(const TAsyncSharedV2AtomicFixedPointer& src_cref) = default;
+		virtual ~TAsyncSharedV2AtomicFixedPointer() {}
+
+		std::atomic<_Ty>& operator*() const { return (*m_shptr); }
+		std::atomic<_Ty>* operator->() const { return std::addressof(*m_shptr); }
+
+		_Ty load(std::memory_order order = std::memory_order_seq_cst) const { return m_shptr->load(order); }
+		void store(_Ty desired, std::memory_order order = std::memory_order_seq_cst) const { m_shptr->store(desired, order); }
+		_Ty exchange(_Ty desired, std::memory_order order = std::memory_order_seq_cst) const { return m_shptr->exchange(desired, order); }
+		bool compare_exchange_weak(_Ty& expected, _Ty desired, std::memory_order order = std::memory_order_seq_cst) const {
+			return m_shptr->compare_exchange_weak(expected, desired, order);
 		}
-		TAsyncSharedReadOnlyConstPointer<_Ty> try_readlock_ptr() {
-			return TAsyncSharedReadOnlyConstPointer<_Ty>(m_shptr, std::try_to_lock);
+		bool compare_exchange_weak(_Ty& expected, _Ty desired, std::memory_order success, std::memory_order failure) const {
+			return m_shptr->compare_exchange_weak(expected, desired, success, failure);
 		}
-		template<class _Rep, class _Period>
-		TAsyncSharedReadOnlyConstPointer<_Ty> try_readlock_ptr_for(const std::chrono::duration<_Rep, _Period>& _Rel_time) {
-			return TAsyncSharedReadOnlyConstPointer<_Ty>(m_shptr, std::try_to_lock, _Rel_time);
+		bool compare_exchange_strong(_Ty& expected, _Ty desired, std::memory_order order = std::memory_order_seq_cst) const {
+			return m_shptr->compare_exchange_strong(expected, desired, order);
 		}
-		template<class _Clock, class _Duration>
-		TAsyncSharedReadOnlyConstPointer<_Ty> try_readlock_ptr_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
-			return TAsyncSharedReadOnlyConstPointer<_Ty>(m_shptr, std::try_to_lock, _Abs_time);
+		bool compare_exchange_strong(_Ty& expected, _Ty desired, std::memory_order success, std::memory_order failure) const {
+			return m_shptr->compare_exchange_strong(expected, desired, success, failure);
+		}
+		/* (Only available for the types for which std::atomic<> provides them.) */
+		_Ty fetch_add(_Ty arg, std::memory_order order = std::memory_order_seq_cst) const { return m_shptr->fetch_add(arg, order); }
+		_Ty fetch_sub(_Ty arg, std::memory_order order = std::memory_order_seq_cst) const { return m_shptr->fetch_sub(arg, order); }
+		_Ty fetch_and(_Ty arg, std::memory_order order = std::memory_order_seq_cst) const { return m_shptr->fetch_and(arg, order); }
+		_Ty fetch_or(_Ty arg, std::memory_order order = std::memory_order_seq_cst) const { return m_shptr->fetch_or(arg, order); }
+		_Ty fetch_xor(_Ty arg, std::memory_order order = std::memory_order_seq_cst) const { return m_shptr->fetch_xor(arg, order); }
+
+		/* Blocks while the object's value is (bitwise) equal to old_value and until it's notified. */
+		void wait(_Ty old_value, std::memory_order order = std::memory_order_seq_cst) const {
+#ifdef __cpp_lib_atomic_wait
+			m_shptr->wait(old_value, order);
+#else // __cpp_lib_atomic_wait
+			impl::CAtomicWaitTable::wait(*m_shptr, old_value, order);
+#endif // __cpp_lib_atomic_wait
+		}
+		void notify_one() const {
+#ifdef __cpp_lib_atomic_wait
+			m_shptr->notify_one();
+#else // __cpp_lib_atomic_wait
+			/* (The table's entries may be shared by other objects, so notify_one() wakes all the entry's waiters.) */
+			impl::CAtomicWaitTable::notify(*m_shptr);
+#endif // __cpp_lib_atomic_wait
+		}
+		void notify_all() const {
+#ifdef __cpp_lib_atomic_wait
+			m_shptr->notify_all();
+#else // __cpp_lib_atomic_wait
+			impl::CAtomicWaitTable::notify(*m_shptr);
+#endif // __cpp_lib_atomic_wait
 		}
 
 		template <class... Args>
-		static TAsyncSharedReadOnlyAccessRequester make_asyncsharedreadonly(Args&&... args) {
-			//auto shptr = std::make_shared<const TAsyncSharedObj<_Ty>>(std::forward<Args>(args)...);
-			std::shared_ptr<const TAsyncSharedObj<_Ty>> shptr(new const TAsyncSharedObj<_Ty>(std::forward<Args>(args)...));
-			TAsyncSharedReadOnlyAccessRequester retval(shptr);
+		static TAsyncSharedV2AtomicFixedPointer make_asyncsharedv2atomic(Args&&... args) {
+			auto shptr = std::make_shared<std::atomic<_Ty>>(_Ty(std::forward<Args>(args)...));
+			TAsyncSharedV2AtomicFixedPointer retval(shptr);
+			return retval;
+		}
+		template <class _TAlloc, class... Args>
+		static TAsyncSharedV2AtomicFixedPointer allocate_asyncsharedv2atomic(const _TAlloc& alloc, Args&&... args) {
+			auto shptr = std::allocate_shared<std::atomic<_Ty>>(alloc, _Ty(std::forward<Args>(args)...));
+			TAsyncSharedV2AtomicFixedPointer retval(shptr);
 			return retval;
 		}
 
 	private:
-		TAsyncSharedReadOnlyAccessRequester(std::shared_ptr<const TAsyncSharedObj<_Ty>> shptr) : m_shptr(shptr) {}
+		TAsyncSharedV2AtomicFixedPointer(std::shared_ptr<std::atomic<_Ty>> shptr) : m_shptr(shptr) {}
+		TAsyncSharedV2AtomicFixedPointer<_Ty>& operator=(const TAsyncSharedV2AtomicFixedPointer<_Ty>& _Right_cref) = delete;
 
-		TAsyncSharedReadOnlyAccessRequester<_Ty>* operator&() { return this; }
-		const TAsyncSharedReadOnlyAccessRequester<_Ty>* operator&() const { return this; }
+		TAsyncSharedV2AtomicFixedPointer<_Ty>* operator&() { return this; }
+		const TAsyncSharedV2AtomicFixedPointer<_Ty>* operator&() const { return this; }
 
-		std::shared_ptr<const TAsyncSharedObj<_Ty>> m_shptr;
+		std::shared_ptr<std::atomic<_Ty>> m_shptr;
 	};
 
 	template <class X, class... Args>
-	TAsyncSharedReadOnlyAccessRequester<X> make_asyncsharedreadonly(Args&&... args) {
-		return TAsyncSharedReadOnlyAccessRequester<X>::make_asyncsharedreadonly(std::forward<Args>(args)...);
+	TAsyncSharedV2AtomicFixedPointer<X> make_asyncsharedv2atomic(Args&&... args) {
+		return TAsyncSharedV2AtomicFixedPointer<X>::make_asyncsharedv2atomic(std::forward<Args>(args)...);
+	}
+	template <class X, class _TAlloc, class... Args>
+	TAsyncSharedV2AtomicFixedPointer<X> allocate_asyncsharedv2atomic(const _TAlloc& alloc, Args&&... args) {
+		return TAsyncSharedV2AtomicFixedPointer<X>::allocate_asyncsharedv2atomic(alloc, std::forward<Args>(args)...);
 	}
 
+	namespace impl {
+		template<typename _Ty>
+		class TActorMessageBase {
+		public:
+			virtual ~TActorMessageBase() {}
+			virtual void execute(_Ty& obj_ref) = 0;
 
-	template<typename _Ty>
-	class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer {
-	public:
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer(TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer&& src) = default;
-		virtual ~TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer() {}
-
-		operator bool() const {
-			//if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer")); }
-			return m_shptr.operator bool();
-		}
-		typename std::conditional<std::is_const<_Ty>::value
-			, const TAsyncSharedObj<_Ty>&, TAsyncSharedObj<_Ty>&>::type operator*() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer")); }
-			return (*m_shptr);
-		}
-		typename std::conditional<std::is_const<_Ty>::value
-			, const TAsyncSharedObj<_Ty>*, TAsyncSharedObj<_Ty>*>::type operator->() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer")); }
-			return std::addressof(*m_shptr);
-		}
-	private:
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1) {}
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_unique_lock.try_lock()) {
-				shptr = nullptr;
+			TActorMessageBase* m_next_ptr = nullptr;
+		};
+		template<typename _Ty, class _TFunction>
+		class TActorPostMessage : public TActorMessageBase<_Ty> {
+		public:
+			TActorPostMessage(_TFunction&& function) : m_function(std::move(function)) {}
+			void execute(_Ty& obj_ref) override {
+				m_function(obj_ref);
 			}
+		private:
+			_TFunction m_function;
+		};
+		template<class _TResult, class _TFunction, typename _Ty>
+		void fulfill_promise(std::promise<_TResult>& promise_ref, _TFunction& function_ref, _Ty& obj_ref) {
+			promise_ref.set_value(function_ref(obj_ref));
 		}
-		template<class _Rep, class _Period>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::duration<_Rep, _Period>& _Rel_time) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_unique_lock.try_lock_for(_Rel_time)) {
-				shptr = nullptr;
-			}
+		template<class _TFunction, typename _Ty>
+		void fulfill_promise(std::promise<void>& promise_ref, _TFunction& function_ref, _Ty& obj_ref) {
+			function_ref(obj_ref);
+			promise_ref.set_value();
 		}
-		template<class _Clock, class _Duration>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) : m_shptr(shptr), m_unique_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_unique_lock.try_lock_until(_Abs_time)) {
-				shptr = nullptr;
+		template<typename _Ty, class _TFunction, class _TResult>
+		class TActorCallMessage : public TActorMessageBase<_Ty> {
+		public:
+			TActorCallMessage(_TFunction&& function) : m_function(std::move(function)) {}
+			void execute(_Ty& obj_ref) override {
+				try {
+					fulfill_promise(m_promise, m_function, obj_ref);
+				}
+				catch (...) {
+					m_promise.set_exception(std::current_exception());
+				}
 			}
-		}
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty>& operator=(const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty>& _Right_cref) = delete;
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty>& operator=(TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty>&& _Right) = delete;
+			std::future<_TResult> get_future() { return m_promise.get_future(); }
+		private:
+			_TFunction m_function;
+			std::promise<_TResult> m_promise;
+		};
 
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty>* operator&() { return this; }
-		const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty>* operator&() const { return this; }
-		bool is_valid() const {
-			bool retval = m_shptr.operator bool();
-			return retval;
-		}
+		/* An actor's state: the object, its (lock free, multiple producer, single consumer) mailbox and the loop run
+		by the owner thread. Messages are pushed onto a (LIFO) list, and the owner thread takes the whole list at once
+		and executes the messages, in the order they were posted, as one batch. */
+		template<typename _Ty>
+		class TActorState {
+		public:
+			template<class... Args>
+			TActorState(Args&&... args) : m_obj(std::forward<Args>(args)...) {}
+			~TActorState() {
+				/* (Only messages posted after the stop message could remain.) */
+				delete_messages(m_head_ptr.exchange(nullptr, std::memory_order_acquire));
+			}
 
-		std::shared_ptr<TAsyncSharedObj<_Ty>> m_shptr;
-		std::unique_lock<async_shared_timed_mutex_type> m_unique_lock;
+			void push(TActorMessageBase<_Ty>* message_ptr) {
+				auto head_ptr = m_head_ptr.load(std::memory_order_relaxed);
+				do {
+					message_ptr->m_next_ptr = head_ptr;
+				} while (!m_head_ptr.compare_exchange_weak(head_ptr, message_ptr, std::memory_order_release, std::memory_order_relaxed));
+				if (!head_ptr) {
+					/* The mailbox was empty, so the owner thread may be waiting. */
+#ifdef __cpp_lib_atomic_wait
+					m_head_ptr.notify_one();
+#else // __cpp_lib_atomic_wait
+					CAtomicWaitTable::notify(m_head_ptr);
+#endif // __cpp_lib_atomic_wait
+				}
+			}
+			/* The owner thread exits after executing the messages posted before this one. */
+			void stop() {
+				push(new CStopMessage(*this));
+			}
 
-		friend class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<_Ty>;
-	};
+			/* (Executed by the owner thread.) */
+			void run() {
+				while (!m_is_stopping) {
+					auto lifo_ptr = m_head_ptr.exchange(nullptr, std::memory_order_acquire);
+					if (!lifo_ptr) {
+						wait_for_messages();
+						continue;
+					}
+					TActorMessageBase<_Ty>* fifo_ptr = nullptr;
+					while (lifo_ptr) {
+						auto next_ptr = lifo_ptr->m_next_ptr;
+						lifo_ptr->m_next_ptr = fifo_ptr;
+						fifo_ptr = lifo_ptr;
+						lifo_ptr = next_ptr;
+					}
+					while (fifo_ptr) {
+						std::unique_ptr<TActorMessageBase<_Ty>> message_uqptr(fifo_ptr);
+						fifo_ptr = fifo_ptr->m_next_ptr;
+						try {
+							message_uqptr->execute(m_obj);
+						}
+						catch (...) {
+							/* (Exceptions thrown by post()ed functions are discarded. (call() propagates them via the future.)) */
+						}
+					}
+				}
+			}
 
-	template<typename _Ty>
-	class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer {
-	public:
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer(TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer&& src) = default;
-		virtual ~TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer() {}
+		private:
+			class CStopMessage : public TActorMessageBase<_Ty> {
+			public:
+				CStopMessage(TActorState& state_ref) : m_state_ref(state_ref) {}
+				void execute(_Ty&) override { m_state_ref.m_is_stopping = true; }
+				TActorState& m_state_ref;
+			};
 
-		operator bool() const {
-			//if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer")); }
-			return m_shptr.operator bool();
-		}
-		const TAsyncSharedObj<const _Ty>& operator*() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer")); }
-			const TAsyncSharedObj<const _Ty>* extra_const_ptr = reinterpret_cast<const TAsyncSharedObj<const _Ty>*>(std::addressof(*m_shptr));
-			return (*extra_const_ptr);
-		}
-		const TAsyncSharedObj<const _Ty>* operator->() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer")); }
-			const TAsyncSharedObj<const _Ty>* extra_const_ptr = reinterpret_cast<const TAsyncSharedObj<const _Ty>*>(std::addressof(*m_shptr));
-			return extra_const_ptr;
-		}
-	private:
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr) : m_shptr(shptr), m_shared_lock(shptr->m_mutex1) {}
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t) : m_shptr(shptr), m_shared_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_shared_lock.try_lock()) {
-				shptr = nullptr;
-			}
-		}
-		template<class _Rep, class _Period>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::duration<_Rep, _Period>& _Rel_time) : m_shptr(shptr), m_shared_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_shared_lock.try_lock_for(_Rel_time)) {
-				shptr = nullptr;
+			void wait_for_messages() {
+				/* A (short) spin before sleeping, since a message often follows closely. */
+				for (size_t i = 0; sc_num_idle_spins > i; i += 1) {
+					if (m_head_ptr.load(std::memory_order_relaxed)) {
+						return;
+					}
+					cpu_relax();
+				}
+#ifdef __cpp_lib_atomic_wait
+				m_head_ptr.wait(nullptr, std::memory_order_acquire);
+#else // __cpp_lib_atomic_wait
+				/* (The wait is bounded so that the owner periodically re-checks its mailbox regardless, as a backstop against
+				a missed notification in the (emulated) wait.) */
+				CAtomicWaitTable::wait_for(m_head_ptr, static_cast<TActorMessageBase<_Ty>*>(nullptr), std::memory_order_acquire, sc_max_idle_wait);
+#endif // __cpp_lib_atomic_wait
 			}
-		}
-		template<class _Clock, class _Duration>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) : m_shptr(shptr), m_shared_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_shared_lock.try_lock_until(_Abs_time)) {
-				shptr = nullptr;
+			static void delete_messages(TActorMessageBase<_Ty>* message_ptr) {
+				while (message_ptr) {
+					auto next_ptr = message_ptr->m_next_ptr;
+					delete message_ptr;
+					message_ptr = next_ptr;
+				}
 			}
-		}
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty>& operator=(const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty>& _Right_cref) = delete;
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty>& operator=(TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty>&& _Right) = delete;
 
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty>* operator&() { return this; }
-		const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty>* operator&() const { return this; }
-		bool is_valid() const {
-			bool retval = m_shptr.operator bool();
-			return retval;
-		}
+			static const size_t sc_num_idle_spins = 256;
+#ifndef __cpp_lib_atomic_wait
+			static constexpr std::chrono::milliseconds sc_max_idle_wait{ 50 };
+#endif // !__cpp_lib_atomic_wait
 
-		std::shared_ptr<TAsyncSharedObj<_Ty>> m_shptr;
-		std::shared_lock<async_shared_timed_mutex_type> m_shared_lock;
+			_Ty m_obj;
+			alignas(sc_cache_line_size) std::atomic<TActorMessageBase<_Ty>*> m_head_ptr{ nullptr };
+			bool m_is_stopping = false;
+		};
 
-		friend class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<_Ty>;
-	};
+		/* Owns the owner thread. (Shared by the access requesters.) When the last access requester goes away, the
+		messages already posted are executed, then the owner thread exits. */
+		template<typename _Ty>
+		class TActorOwner {
+		public:
+			TActorOwner(const std::shared_ptr<TActorState<_Ty>>& state_shptr) : m_state_shptr(state_shptr), m_thread([state_shptr]() { state_shptr->run(); }) {}
+			~TActorOwner() {
+				m_state_shptr->stop();
+				if (std::this_thread::get_id() == m_thread.get_id()) {
+					/* The last access requester was released by a function executing on the owner thread (which can't
+					join itself). The thread holds a reference to the state, so it can just be left to finish. */
+					m_thread.detach();
+				}
+				else {
+					m_thread.join();
+				}
+			}
+
+			std::shared_ptr<TActorState<_Ty>> m_state_shptr;
+			std::thread m_thread;
+		};
+	}
 
+	/* TAsyncSharedActorAccessRequester is for (heavily contended) shared objects that are modified by many threads.
+	Rather than each thread acquiring a lock and accessing the object itself (in which case the object and the lock
+	"ping-pong" between the cores' caches), the object is owned by a dedicated thread, and only ever accessed by that
+	thread. Other threads post() functions to it (through a lock free mailbox), or call() them and get a std::future
+	of the result. The owner thread executes function(obj) for each, in the order they were posted (per posting
+	thread), in batches. So the object, and the functions' code, stay in the owner's cache. Note that the functions
+	must not retain references to the object, and a function must not wait on the future of a call() to the same
+	actor (as it would be waiting for itself). Exceptions thrown by post()ed functions are discarded. The owner thread
+	exits (after executing the functions already posted) when the last access requester is destroyed. Use
+	mse::make_asyncsharedactor<>() to construct one. */
 	template<typename _Ty>
-	class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester {
+	class TAsyncSharedActorAccessRequester {
 	public:
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester(const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester& src_cref) = default;
+		TAsyncSharedActorAccessRequester(const TAsyncSharedActorAccessRequester& src_cref) = default;
 
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty> writelock_ptr() {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty>(m_shptr);
-		}
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty> try_writelock_ptr() {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty>(m_shptr, std::try_to_lock);
-		}
-		template<class _Rep, class _Period>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty> try_writelock_ptr_for(const std::chrono::duration<_Rep, _Period>& _Rel_time) {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty>(m_shptr, std::try_to_lock, _Rel_time);
-		}
-		template<class _Clock, class _Duration>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty> try_writelock_ptr_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWritePointer<_Ty>(m_shptr, std::try_to_lock, _Abs_time);
-		}
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty> readlock_ptr() {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty>(m_shptr);
-		}
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty> try_readlock_ptr() {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty>(m_shptr, std::try_to_lock);
+		/* Asynchronously executes function(obj) on the owner thread. */
+		template<class _TFunction>
+		void post(_TFunction function) {
+			m_owner_shptr->m_state_shptr->push(new impl::TActorPostMessage<_Ty, _TFunction>(std::move(function)));
 		}
-		template<class _Rep, class _Period>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty> try_readlock_ptr_for(const std::chrono::duration<_Rep, _Period>& _Rel_time) {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty>(m_shptr, std::try_to_lock, _Rel_time);
+		/* Like post(), but returns a std::future of the function's result (or exception). */
+		template<class _TFunction>
+		auto call(_TFunction function) -> std::future<typename std::decay<decltype(function(std::declval<_Ty&>()))>::type> {
+			typedef typename std::decay<decltype(function(std::declval<_Ty&>()))>::type result_type;
+			auto message_ptr = new impl::TActorCallMessage<_Ty, _TFunction, result_type>(std::move(function));
+			auto future1 = message_ptr->get_future();
+			m_owner_shptr->m_state_shptr->push(message_ptr);
+			return future1;
 		}
-		template<class _Clock, class _Duration>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty> try_readlock_ptr_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteConstPointer<_Ty>(m_shptr, std::try_to_lock, _Abs_time);
+		/* The thread that executes the functions. */
+		std::thread::id owner_thread_id() const {
+			return m_owner_shptr->m_thread.get_id();
 		}
 
 		template <class... Args>
-		static TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite(Args&&... args) {
-			//auto shptr = std::make_shared<TAsyncSharedObj<_Ty>>(std::forward<Args>(args)...);
-			std::shared_ptr<TAsyncSharedObj<_Ty>> shptr(new TAsyncSharedObj<_Ty>(std::forward<Args>(args)...));
-			TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester retval(shptr);
+		static TAsyncSharedActorAccessRequester make_asyncsharedactor(Args&&... args) {
+			auto state_shptr = std::make_shared<impl::TActorState<_Ty>>(std::forward<Args>(args)...);
+			TAsyncSharedActorAccessRequester retval(std::make_shared<impl::TActorOwner<_Ty>>(state_shptr));
+			return retval;
+		}
+		/* Like make_asyncsharedactor(), but the object's state is allocated with the given allocator. */
+		template <class _TAlloc, class... Args>
+		static TAsyncSharedActorAccessRequester allocate_asyncsharedactor(const _TAlloc& alloc, Args&&... args) {
+			auto state_shptr = std::allocate_shared<impl::TActorState<_Ty>>(alloc, std::forward<Args>(args)...);
+			TAsyncSharedActorAccessRequester retval(std::make_shared<impl::TActorOwner<_Ty>>(state_shptr));
 			return retval;
 		}
 
 	private:
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr) : m_shptr(shptr) {}
+		TAsyncSharedActorAccessRequester(std::shared_ptr<impl::TActorOwner<_Ty>> owner_shptr) : m_owner_shptr(owner_shptr) {}
 
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<_Ty>* operator&() { return this; }
-		const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<_Ty>* operator&() const { return this; }
+		TAsyncSharedActorAccessRequester<_Ty>* operator&() { return this; }
+		const TAsyncSharedActorAccessRequester<_Ty>* operator&() const { return this; }
 
-		std::shared_ptr<TAsyncSharedObj<_Ty>> m_shptr;
+		std::shared_ptr<impl::TActorOwner<_Ty>> m_owner_shptr;
 	};
 
 	template <class X, class... Args>
-	TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<X> make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite(Args&&... args) {
-		return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<X>::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadwrite(std::forward<Args>(args)...);
+	TAsyncSharedActorAccessRequester<X> make_asyncsharedactor(Args&&... args) {
+		return TAsyncSharedActorAccessRequester<X>::make_asyncsharedactor(std::forward<Args>(args)...);
 	}
+	template <class X, class _TAlloc, class... Args>
+	TAsyncSharedActorAccessRequester<X> allocate_asyncsharedactor(const _TAlloc& alloc, Args&&... args) {
+		return TAsyncSharedActorAccessRequester<X>::allocate_asyncsharedactor(alloc, std::forward<Args>(args)...);
+	}
+
+	namespace impl {
+		/* A minimal hazard pointer implementation for TAsyncSharedSnapshotAccessRequester. Readers "protect" the version
+		they're reading by publishing its address in a hazard slot of their own (so they don't write to any memory shared
+		with other readers). Retired versions are only deleted once no hazard slot refers to them. */
+		class CHazardRetiredBase {
+		public:
+			virtual ~CHazardRetiredBase() {}
+			/* Set (once) when the object is retired. */
+			std::atomic<bool> m_is_retired{ false };
+		};
+
+		class CHazardSlot {
+		public:
+			alignas(sc_cache_line_size) std::atomic<const CHazardRetiredBase*> m_protected_ptr{ nullptr };
+			std::atomic<bool> m_is_in_use{ false };
+			CHazardSlot* m_next_ptr = nullptr;
+		};
+
+		class CHazardPointerDomain {
+		public:
+			/* (The domain is intentionally never destroyed, as readers' thread local slot caches and retired objects may
+			outlive any static object.) */
+			static CHazardPointerDomain& instance() {
+				static CHazardPointerDomain* s_domain_ptr = new CHazardPointerDomain();
+				return *s_domain_ptr;
+			}
+
+			CHazardSlot& acquire_slot() {
+				auto& free_slots_ref = thread_local_free_slots().m_slot_ptrs;
+				if (!free_slots_ref.empty()) {
+					auto slot_ptr = free_slots_ref.back();
+					free_slots_ref.pop_back();
+					return *slot_ptr;
+				}
+				for (auto slot_ptr = m_slots_head_ptr.load(std::memory_order_acquire); slot_ptr; slot_ptr = slot_ptr->m_next_ptr) {
+					bool expected = false;
+					if ((!slot_ptr->m_is_in_use.load(std::memory_order_relaxed))
+						&& slot_ptr->m_is_in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+						return *slot_ptr;
+					}
+				}
+				auto slot_ptr = new CHazardSlot();
+				slot_ptr->m_is_in_use.store(true, std::memory_order_relaxed);
+				auto head_ptr = m_slots_head_ptr.load(std::memory_order_relaxed);
+				do {
+					slot_ptr->m_next_ptr = head_ptr;
+				} while (!m_slots_head_ptr.compare_exchange_weak(head_ptr, slot_ptr, std::memory_order_release, std::memory_order_relaxed));
+				return *slot_ptr;
+			}
+			void release_slot(CHazardSlot& slot_ref) {
+				slot_ref.m_protected_ptr.store(nullptr, std::memory_order_release);
+				thread_local_free_slots().m_slot_ptrs.push_back(&slot_ref);
+			}
+
+			/* Hands the object over to the domain, which deletes it once it's no longer protected by any hazard slot. */
+			void retire(CHazardRetiredBase* retired_ptr) {
+				retired_ptr->m_is_retired.store(true, std::memory_order_release);
+				std::lock_guard<std::mutex> lock1(m_retired_mutex);
+				m_retired_ptrs.push_back(retired_ptr);
+				reclaim();
+			}
+			/* Called by readers releasing a retired object. */
+			void try_reclaim() {
+				std::unique_lock<std::mutex> lock1(m_retired_mutex, std::try_to_lock);
+				if (lock1.owns_lock()) {
+					reclaim();
+				}
+			}
+			size_t num_retired() const {
+				std::lock_guard<std::mutex> lock1(m_retired_mutex);
+				return m_retired_ptrs.size();
+			}
+
+		private:
+			CHazardPointerDomain() {}
+
+			class CThreadLocalFreeSlots {
+			public:
+				~CThreadLocalFreeSlots() {
+					for (auto slot_ptr : m_slot_ptrs) {
+						slot_ptr->m_is_in_use.store(false, std::memory_order_release);
+					}
+				}
+				std::vector<CHazardSlot*> m_slot_ptrs;
+			};
+			static CThreadLocalFreeSlots& thread_local_free_slots() {
+				thread_local CThreadLocalFreeSlots tl_free_slots;
+				return tl_free_slots;
+			}
+
+			/* The caller must hold m_retired_mutex. */
+			void reclaim() {
+				/* (Pairs with the fence in the readers' protect loop.) */
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				m_protected_ptrs.clear();
+				for (auto slot_ptr = m_slots_head_ptr.load(std::memory_order_acquire); slot_ptr; slot_ptr = slot_ptr->m_next_ptr) {
+					auto protected_ptr = slot_ptr->m_protected_ptr.load(std::memory_order_acquire);
+					if (protected_ptr) {
+						m_protected_ptrs.push_back(protected_ptr);
+					}
+				}
+				std::sort(m_protected_ptrs.begin(), m_protected_ptrs.end());
+				auto new_end = std::remove_if(m_retired_ptrs.begin(), m_retired_ptrs.end(), [this](CHazardRetiredBase* retired_ptr) {
+					if (std::binary_search(m_protected_ptrs.begin(), m_protected_ptrs.end(), retired_ptr)) {
+						return false;
+					}
+					delete retired_ptr;
+					return true;
+				});
+				m_retired_ptrs.erase(new_end, m_retired_ptrs.end());
+			}
+
+			std::atomic<CHazardSlot*> m_slots_head_ptr{ nullptr };
+			mutable std::mutex m_retired_mutex;
+			std::vector<CHazardRetiredBase*> m_retired_ptrs;
+			std::vector<const CHazardRetiredBase*> m_protected_ptrs;
+		};
+
+		template<typename _Ty>
+		class TSnapshotVersion : public CHazardRetiredBase {
+		public:
+			template <class... Args>
+			TSnapshotVersion(Args&&... args) : m_value(std::forward<Args>(args)...) {}
+			const _Ty m_value;
+		};
+
+		/* The state shared by TAsyncSharedSnapshotAccessRequesters: the current version, and a mutex serializing the
+		writers. */
+		template<typename _Ty>
+		class TSnapshotObj {
+		public:
+			template <class... Args>
+			TSnapshotObj(Args&&... args) : m_current_ptr(new TSnapshotVersion<_Ty>(std::forward<Args>(args)...)) {}
+			~TSnapshotObj() {
+				/* (There may still be snapshot pointers to the current version.) */
+				CHazardPointerDomain::instance().retire(m_current_ptr.load(std::memory_order_relaxed));
+			}
+
+			/* Returns the current version, protected by the given hazard slot. */
+			const TSnapshotVersion<_Ty>* protect(CHazardSlot& slot_ref) const {
+				auto version_ptr = m_current_ptr.load(std::memory_order_acquire);
+				while (true) {
+					slot_ref.m_protected_ptr.store(version_ptr, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					auto version2_ptr = m_current_ptr.load(std::memory_order_acquire);
+					if (version2_ptr == version_ptr) {
+						return version_ptr;
+					}
+					version_ptr = version2_ptr;
+				}
+			}
+			void store(TSnapshotVersion<_Ty>* new_version_ptr) {
+				std::lock_guard<std::mutex> lock1(m_writer_mutex);
+				publish(new_version_ptr);
+			}
+			template<class _TFunction>
+			void modify(const _TFunction& func) {
+				std::lock_guard<std::mutex> lock1(m_writer_mutex);
+				/* (Holding the writer mutex, the current version can't be retired from under us.) */
+				_Ty value(m_current_ptr.load(std::memory_order_relaxed)->m_value);
+				func(value);
+				publish(new TSnapshotVersion<_Ty>(std::move(value)));
+			}
+
+		private:
+			/* The caller must hold m_writer_mutex. */
+			void publish(TSnapshotVersion<_Ty>* new_version_ptr) {
+				auto old_version_ptr = m_current_ptr.exchange(new_version_ptr, std::memory_order_acq_rel);
+				CHazardPointerDomain::instance().retire(old_version_ptr);
+			}
 
+			alignas(sc_cache_line_size) std::atomic<TSnapshotVersion<_Ty>*> m_current_ptr;
+			alignas(sc_cache_line_size) std::mutex m_writer_mutex;
+		};
+	}
 
+	/* An immutable snapshot of (a version of) the object shared via TAsyncSharedSnapshotAccessRequesters. The snapshot
+	remains valid (and unchanged) for the lifetime of the pointer, regardless of subsequent modifications (and even if
+	all the access requesters are gone). */
 	template<typename _Ty>
-	class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer {
+	class TAsyncSharedSnapshotConstPointer {
 	public:
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer(TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer&& src) = default;
-		virtual ~TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer() {}
+		TAsyncSharedSnapshotConstPointer(const TAsyncSharedSnapshotConstPointer& src_cref) : m_slot_ptr(nullptr), m_version_ptr(src_cref.m_version_ptr) {
+			if (m_version_ptr) {
+				/* (The source's hazard slot keeps the version alive while we protect it with our own.) */
+				m_slot_ptr = &(impl::CHazardPointerDomain::instance().acquire_slot());
+				m_slot_ptr->m_protected_ptr.store(m_version_ptr, std::memory_order_seq_cst);
+			}
+		}
+		TAsyncSharedSnapshotConstPointer(TAsyncSharedSnapshotConstPointer&& src) : m_slot_ptr(src.m_slot_ptr), m_version_ptr(src.m_version_ptr) {
+			src.m_slot_ptr = nullptr;
+			src.m_version_ptr = nullptr;
+		}
+		~TAsyncSharedSnapshotConstPointer() {
+			/* (m_slot_ptr is non-null iff m_version_ptr is.) */
+			if (m_version_ptr) {
+				/* (The version may be deleted as soon as it's no longer protected, so check first.) */
+				const bool is_retired = m_version_ptr->m_is_retired.load(std::memory_order_acquire);
+				impl::CHazardPointerDomain::instance().release_slot(*m_slot_ptr);
+				if (is_retired) {
+					/* This may have been the last reader of an old version. */
+					impl::CHazardPointerDomain::instance().try_reclaim();
+				}
+			}
+		}
 
 		operator bool() const {
-			//if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer")); }
-			return m_shptr.operator bool();
+			return (nullptr != m_version_ptr);
 		}
-		const TAsyncSharedObj<const _Ty>& operator*() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer")); }
-			const TAsyncSharedObj<const _Ty>* extra_const_ptr = reinterpret_cast<const TAsyncSharedObj<const _Ty>*>(std::addressof(*m_shptr));
-			return (*extra_const_ptr);
+		const _Ty& operator*() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedSnapshotConstPointer");
+			return m_version_ptr->m_value;
 		}
-		const TAsyncSharedObj<const _Ty>* operator->() const {
-			if (!is_valid()) { throw(std::out_of_range("attempt to use invalid pointer - mse::TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer")); }
-			const TAsyncSharedObj<const _Ty>* extra_const_ptr = reinterpret_cast<const TAsyncSharedObj<const _Ty>*>(std::addressof(*m_shptr));
-			return extra_const_ptr;
+		const _Ty* operator->() const {
+			MSE_ASYNCSHARED_POINTER_CHECK_VALID("attempt to use invalid pointer - mse::TAsyncSharedSnapshotConstPointer");
+			return std::addressof(m_version_ptr->m_value);
 		}
+
 	private:
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer(std::shared_ptr<const TAsyncSharedObj<_Ty>> shptr) : m_shptr(shptr), m_shared_lock(shptr->m_mutex1) {}
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t) : m_shptr(shptr), m_shared_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_shared_lock.try_lock()) {
-				shptr = nullptr;
-			}
-		}
-		template<class _Rep, class _Period>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::duration<_Rep, _Period>& _Rel_time) : m_shptr(shptr), m_shared_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_shared_lock.try_lock_for(_Rel_time)) {
-				shptr = nullptr;
-			}
-		}
-		template<class _Clock, class _Duration>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer(std::shared_ptr<TAsyncSharedObj<_Ty>> shptr, std::try_to_lock_t, const std::chrono::time_point<_Clock, _Duration>& _Abs_time) : m_shptr(shptr), m_shared_lock(shptr->m_mutex1, std::defer_lock) {
-			if (!m_shared_lock.try_lock_until(_Abs_time)) {
-				shptr = nullptr;
-			}
+		TAsyncSharedSnapshotConstPointer(const impl::TSnapshotObj<_Ty>& snapshot_obj_cref) : m_slot_ptr(&(impl::CHazardPointerDomain::instance().acquire_slot())) {
+			m_version_ptr = snapshot_obj_cref.protect(*m_slot_ptr);
 		}
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty>& operator=(const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty>& _Right_cref) = delete;
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty>& operator=(TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty>&& _Right) = delete;
+		TAsyncSharedSnapshotConstPointer<_Ty>& operator=(const TAsyncSharedSnapshotConstPointer<_Ty>& _Right_cref) = delete;
+		TAsyncSharedSnapshotConstPointer<_Ty>& operator=(TAsyncSharedSnapshotConstPointer<_Ty>&& _Right) = delete;
 
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty>* operator&() { return this; }
-		const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty>* operator&() const { return this; }
+		TAsyncSharedSnapshotConstPointer<_Ty>* operator&() { return this; }
+		const TAsyncSharedSnapshotConstPointer<_Ty>* operator&() const { return this; }
 		bool is_valid() const {
-			bool retval = m_shptr.operator bool();
-			return retval;
+			return (nullptr != m_version_ptr);
 		}
 
-		std::shared_ptr<const TAsyncSharedObj<_Ty>> m_shptr;
-		std::shared_lock<async_shared_timed_mutex_type> m_shared_lock;
+		impl::CHazardSlot* m_slot_ptr;
+		const impl::TSnapshotVersion<_Ty>* m_version_ptr;
 
-		friend class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<_Ty>;
+		template<typename _Ty2> friend class TAsyncSharedSnapshotAccessRequester;
 	};
 
+	/* TAsyncSharedSnapshotAccessRequester is intended for read-mostly objects (including large ones) that readers access
+	through (read-only) snapshots rather than through a lock. snapshot_ptr() doesn't lock anything or modify any memory
+	shared with other readers (it publishes the version it's reading in a "hazard pointer" slot of the calling thread's
+	own). Writers (store() and modify()), serialized with a mutex, construct a new version of the object and atomically
+	replace the current one with it. The old version is deleted once the last snapshot of it is released (or, if that
+	release races with the replacement, by a subsequent write). Note that (unlike with the lock pointers) a snapshot can
+	be out of date by the time it's used. And modify() copies the object, so it's best suited for objects that are
+	modified infrequently. */
 	template<typename _Ty>
-	class TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester {
+	class TAsyncSharedSnapshotAccessRequester {
 	public:
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester(const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester& src_cref) = default;
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester(const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadWriteAccessRequester<_Ty>& src_cref) : m_shptr(src_cref.m_shptr) {}
+		TAsyncSharedSnapshotAccessRequester(const TAsyncSharedSnapshotAccessRequester& src_cref) = default;
 
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty> readlock_ptr() {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty>(m_shptr);
+		TAsyncSharedSnapshotConstPointer<_Ty> snapshot_ptr() const {
+			return TAsyncSharedSnapshotConstPointer<_Ty>(*m_shptr);
 		}
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty> try_readlock_ptr() {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty>(m_shptr, std::try_to_lock);
+		/* Replaces the shared object with a new version. */
+		void store(const _Ty& value) {
+			m_shptr->store(new impl::TSnapshotVersion<_Ty>(value));
 		}
-		template<class _Rep, class _Period>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty> try_readlock_ptr_for(const std::chrono::duration<_Rep, _Period>& _Rel_time) {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty>(m_shptr, std::try_to_lock, _Rel_time);
+		void store(_Ty&& value) {
+			m_shptr->store(new impl::TSnapshotVersion<_Ty>(std::move(value)));
 		}
-		template<class _Clock, class _Duration>
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty> try_readlock_ptr_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) {
-			return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyConstPointer<_Ty>(m_shptr, std::try_to_lock, _Abs_time);
+		/* Calls func() with a (non-const) reference to a copy of the current version of the shared object, then
+		publishes the (modified) copy as the new version, all while holding the writer lock. */
+		template<class _TFunction>
+		void modify(const _TFunction& func) {
+			m_shptr->modify(func);
 		}
 
 		template <class... Args>
-		static TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadonly(Args&&... args) {
-			//auto shptr = std::make_shared<const TAsyncSharedObj<_Ty>>(std::forward<Args>(args)...);
-			std::shared_ptr<const TAsyncSharedObj<_Ty>> shptr(new const TAsyncSharedObj<_Ty>(std::forward<Args>(args)...));
-			TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester retval(shptr);
+		static TAsyncSharedSnapshotAccessRequester make_asyncsharedsnapshot(Args&&... args) {
+			auto shptr = std::make_shared<impl::TSnapshotObj<_Ty>>(std::forward<Args>(args)...);
+			TAsyncSharedSnapshotAccessRequester retval(shptr);
 			return retval;
 		}
 
 	private:
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester(std::shared_ptr<const TAsyncSharedObj<_Ty>> shptr) : m_shptr(shptr) {}
+		TAsyncSharedSnapshotAccessRequester(std::shared_ptr<impl::TSnapshotObj<_Ty>> shptr) : m_shptr(shptr) {}
 
-		TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<_Ty>* operator&() { return this; }
-		const TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<_Ty>* operator&() const { return this; }
+		TAsyncSharedSnapshotAccessRequester<_Ty>* operator&() { return this; }
+		const TAsyncSharedSnapshotAccessRequester<_Ty>* operator&() const { return this; }
 
-		std::shared_ptr<const TAsyncSharedObj<_Ty>> m_shptr;
+		std::shared_ptr<impl::TSnapshotObj<_Ty>> m_shptr;
 	};
 
 	template <class X, class... Args>
-	TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<X> make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadonly(Args&&... args) {
-		return TAsyncSharedObjectThatYouAreSureHasNoUnprotectedMutablesReadOnlyAccessRequester<X>::make_asyncsharedobjectthatyouaresurehasnounprotectedmutablesreadonly(std::forward<Args>(args)...);
+	TAsyncSharedSnapshotAccessRequester<X> make_asyncsharedsnapshot(Args&&... args) {
+		return TAsyncSharedSnapshotAccessRequester<X>::make_asyncsharedsnapshot(std::forward<Args>(args)...);
 	}
 
+	/* TAsyncSharedV2ImmutableFixedPointer is a (shared, never null) const pointer to an object that is never modified
+	after construction. Because the object is immutable, it can be safely shared among threads without any locking, so
+	unlike the objects shared via the access requesters, no mutex is stored with it. (As with the "no unprotected
+	mutables" access requesters, you're asserting that the type has no mutable members (or other internal state)
+	that could be modified via const methods without being protected by its own synchronization mechanism.) It
+	converts to std::shared_ptr<const _Ty>. Use mse::make_asyncsharedv2immutable<>() to construct one. */
+	template<typename _Ty>
+	class TAsyncSharedV2ImmutableFixedPointer : public std::shared_ptr<const _Ty> {
+	public:
+		TAsyncSharedV2ImmutableFixedPointer(const TAsyncSharedV2ImmutableFixedPointer& src_cref) : std::shared_ptr<const _Ty>(src_cref) {}
+		virtual ~TAsyncSharedV2ImmutableFixedPointer() {}
+		/* This native pointer cast operator is just for compatibility with existing/legacy code and ideally should never be used. */
+		explicit operator const _Ty*() const { return std::shared_ptr<const _Ty>::get(); }
+
+		template <class... Args>
+		static TAsyncSharedV2ImmutableFixedPointer make_asyncsharedv2immutable(Args&&... args) {
+			TAsyncSharedV2ImmutableFixedPointer retval(std::make_shared<const _Ty>(std::forward<Args>(args)...));
+			return retval;
+		}
+		template <class _TAlloc, class... Args>
+		static TAsyncSharedV2ImmutableFixedPointer allocate_asyncsharedv2immutable(const _TAlloc& alloc, Args&&... args) {
+			TAsyncSharedV2ImmutableFixedPointer retval(std::allocate_shared<const _Ty>(alloc, std::forward<Args>(args)...));
+			return retval;
+		}
+
+	private:
+		TAsyncSharedV2ImmutableFixedPointer(std::shared_ptr<const _Ty> shptr) : std::shared_ptr<const _Ty>(shptr) {}
+		TAsyncSharedV2ImmutableFixedPointer<_Ty>& operator=(const TAsyncSharedV2ImmutableFixedPointer<_Ty>& _Right_cref) = delete;
+	};
+
+	template <class X, class... Args>
+	TAsyncSharedV2ImmutableFixedPointer<X> make_asyncsharedv2immutable(Args&&... args) {
+		return TAsyncSharedV2ImmutableFixedPointer<X>::make_asyncsharedv2immutable(std::forward<Args>(args)...);
+	}
+	template <class X, class _TAlloc, class... Args>
+	TAsyncSharedV2ImmutableFixedPointer<X> allocate_asyncsharedv2immutable(const _TAlloc& alloc, Args&&... args) {
+		return TAsyncSharedV2ImmutableFixedPointer<X>::allocate_asyncsharedv2immutable(alloc, std::forward<Args>(args)...);
+	}
 
 	/* For "read-only" situations when you need, or want, the shared object to be managed by std::shared_ptrs we provide a
 	slightly safety enhanced std::shared_ptr wrapper. The wrapper enforces "const"ness and tries to ensure that it always